@@ -0,0 +1,574 @@
+
+/***************************************************************************************
+* Program: smallsh_bench
+* Description: benchmark suite for the shell itself. it links against the same code as
+*	smallsh (everything but main.c) and times:
+*	- parse: smallshGetInput() + smallshParseInput() + expandCommand() over synthetic lines,
+*	  once with each of the lexer's scanners (avx2, sse2, scalar) that this CPU can run, and
+*	  once more through the line cache
+*	- spawn: callExecForeground() on a trivial binary, with both launchers, with and without process groups,
+*	  optionally with the bench process holding extra memory so fork()'s page table copy shows up
+*	- reap: checkBackgroundPids() with 0, 10 and 200 live background jobs
+*	- glob: expandCommand() globbing a directory of 100k files the first time, again out of
+*	  the directory cache, and glibc's glob(3) on the same pattern for comparison
+*	- script: end-to-end commands/sec running a generated script through the smallsh binary,
+*	  with the same commands as separate lines and as the body of one for loop
+*	every result is one row of benchmark,case,metric,value,unit so two builds can be diffed
+*	by a script. 'make bench' builds and runs it, 'make bench DEBUG=0' for optimized numbers.
+*
+* Usage: ./smallsh_bench [-f csv|json] [-s path to smallsh] [-n scale] [-m MiB]
+*	scale multiplies every iteration count, use something like 0.1 for a quick smoke run.
+*	-m touches that much memory before the spawn cases, like a shell that has grown
+***************************************************************************************/
+
+#include "smallsh.h"
+#include <glob.h>
+
+
+#define MAX_RESULTS 256
+#define SPAWN_ITERATIONS 1000
+#define REAP_ITERATIONS 20000
+#define SCRIPT_LINES 20000
+#define PARSE_BYTES_PER_CASE (8 << 20) //each parse case repeats its line until it has about this much input
+#define GLOB_FILES 100000
+#define GLOB_ITERATIONS 200
+
+
+//one row of output
+struct benchResult {
+	const char* benchmark;
+	char testCase[64];
+	const char* metric;
+	double value;
+	const char* unit;
+};
+
+struct benchResult results[MAX_RESULTS];
+int resultCount = 0;
+double scale = 1.0;
+long ballastMiB = 0; //how much memory the spawn cases run with on top of the bench's own, from -m
+
+
+//adds a row to the results
+void addResult(const char* benchmark, const char* testCase, const char* metric, double value, const char* unit) {
+	if (resultCount == MAX_RESULTS) {
+		return;
+	}
+	results[resultCount].benchmark = benchmark;
+	snprintf(results[resultCount].testCase, sizeof(results[resultCount].testCase), "%s", testCase);
+	results[resultCount].metric = metric;
+	results[resultCount].value = value;
+	results[resultCount].unit = unit;
+	resultCount++;
+}
+
+
+//scales an iteration count, never going below 1
+int scaled(int iterations) {
+	int count = iterations * scale;
+	return (count < 1) ? 1 : count;
+}
+
+
+//qsort comparison for latency samples
+int compareSamples(const void* a, const void* b) {
+	long long left = *(const long long*)a;
+	long long right = *(const long long*)b;
+	return (left > right) - (left < right);
+}
+
+
+//sends our stdout to /dev/null while the shell code is printing its job messages, and puts it back afterwards
+int silenceStdout() {
+	fflush(stdout);
+	int saved = dup(STDOUT_FILENO);
+	int devNull = open("/dev/null", O_WRONLY);
+	dup2(devNull, STDOUT_FILENO);
+	close(devNull);
+	return saved;
+}
+
+void restoreStdout(int saved) {
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+}
+
+
+/*	FUNCTION: benchParseCase
+builds a -c style input out of one line repeated over and over, then times getting, parsing and expanding every line of it. with 
+useCache the lines go through the line cache like the main loop's do, so after the second line every one is a hit
+*/
+void benchParseCase(const char* name, const char* line, int useCache) {
+
+	size_t lineLen = strlen(line);
+	int lineCount = scaled(PARSE_BYTES_PER_CASE / (lineLen + 1));
+	char* commands = malloc((lineLen + 1) * lineCount + 1);
+	for (int i = 0; i < lineCount; i++) {
+		memcpy(commands + (i * (lineLen + 1)), line, lineLen);
+		commands[(i * (lineLen + 1)) + lineLen] = '\n';
+	}
+	commands[(lineLen + 1) * lineCount] = '\0';
+
+	struct smallshInput input;
+	struct smallshArena arena = {0};
+	struct smallshContext context = {0};
+	struct smallshLineCache* cache = calloc(1, sizeof(struct smallshLineCache));
+	context.arena = &arena;
+	inputFromString(&input, commands);
+
+	int parsed = 0;
+	int incomplete;
+	long long start = monotonicNanos();
+	char* rawLine;
+	while ((rawLine = smallshGetInput(&input, &arena)) != NULL) {
+		struct smallshNode* node = useCache ? lineCacheParse(cache, rawLine, &arena, &incomplete) : smallshParseInput(rawLine, &arena, &incomplete);
+		if (node != NULL) {
+			expandCommand(node->command, &context);
+			parsed++;
+		}
+		arenaReset(&arena);
+	}
+	long long elapsed = monotonicNanos() - start;
+
+	addResult("parse", name, "ns_per_line", (double)elapsed / lineCount, "ns");
+	addResult("parse", name, "throughput", ((double)lineLen * lineCount / (1 << 20)) / (elapsed / 1e9), "MiB/s");
+	if (parsed != lineCount) {
+		fprintf(stderr, "parse %s: only %d of %d lines parsed\n", name, parsed, lineCount);
+	}
+
+	for (int i = 0; i < LINE_CACHE_SLOTS; i++) {
+		arenaReset(&cache->entries[i].arena);
+		free(cache->entries[i].arena.current);
+	}
+	free(cache);
+	free(commands);
+	free(input.data);
+}
+
+
+//builds a line of 'echo' followed by tokenCount tokens, every pidEvery'th one being '$$' (0 for none)
+char* makeLine(int tokenCount, int pidEvery) {
+	char* line = malloc((tokenCount * 12) + 16);
+	char* out = line + sprintf(line, "echo");
+	for (int i = 0; i < tokenCount; i++) {
+		if (pidEvery > 0 && i % pidEvery == 0) {
+			out += sprintf(out, " $$");
+		}
+		else {
+			out += sprintf(out, " arg%d", i);
+		}
+	}
+	return line;
+}
+
+
+//builds an 'echo' line with one argument of length bytes, double quoted with a few escapes and a variable spread through it
+char* makeQuotedLine(int length) {
+	char* line = malloc((length * 2) + 16);
+	char* out = line + sprintf(line, "echo \"");
+	for (int i = 0; i < length; i++) {
+		if (i % 4096 == 4095) {
+			out += sprintf(out, "\\\"");
+		}
+		else if (i % 65536 == 32768) {
+			out += sprintf(out, "$HOME");
+		}
+		else {
+			*out++ = 'a' + (i % 26);
+		}
+	}
+	strcpy(out, "\"");
+	return line;
+}
+
+
+/*	FUNCTION: benchParse
+runs every parse case once per lexer scanner, the case names get the scanner's name on the end
+*/
+void benchParse() {
+	const char* scanners[] = { "avx2", "sse2", "scalar" };
+	char* small = makeLine(8, 0);
+	char* medium = makeLine(512, 0);
+	char* large = makeLine(20000, 0);
+	char* pidHeavy = makeLine(512, 1);
+	char* quoted = makeQuotedLine(1 << 20);
+	char* redirects = strdup("sort -r < input.txt > output.txt | wc -l &");
+	char* mixed = strdup("grep -e 'it''s a \"match\"' \"$HOME/logs\"/app.log 2>&1|sort -k2,2 -t' '>>\"$HOME/out file\"");
+	char name[64];
+
+	for (int i = 0; i < 3; i++) {
+		if (lexerSelect(scanners[i]) == -1) {
+			continue;
+		}
+		snprintf(name, sizeof(name), "tokens_8_%s", scanners[i]);
+		benchParseCase(name, small, 0);
+		snprintf(name, sizeof(name), "tokens_512_%s", scanners[i]);
+		benchParseCase(name, medium, 0);
+		snprintf(name, sizeof(name), "tokens_20000_%s", scanners[i]);
+		benchParseCase(name, large, 0);
+		snprintf(name, sizeof(name), "pidvars_512_%s", scanners[i]);
+		benchParseCase(name, pidHeavy, 0);
+		snprintf(name, sizeof(name), "quoted_1MiB_%s", scanners[i]);
+		benchParseCase(name, quoted, 0);
+		snprintf(name, sizeof(name), "pipeline_redirects_%s", scanners[i]);
+		benchParseCase(name, redirects, 0);
+		snprintf(name, sizeof(name), "quotes_expansions_%s", scanners[i]);
+		benchParseCase(name, mixed, 0);
+	}
+	lexerSelect(NULL);
+
+	//the cache skips the lexer and parser altogether, so the scanner doesn't matter for these
+	benchParseCase("tokens_8_cached", small, 1);
+	benchParseCase("tokens_512_cached", medium, 1);
+	benchParseCase("quotes_expansions_cached", mixed, 1);
+
+	free(small);
+	free(medium);
+	free(large);
+	free(pidHeavy);
+	free(quoted);
+	free(redirects);
+	free(mixed);
+}
+
+
+/*	FUNCTION: benchSpawn
+times callExecForeground() launching /bin/true until it's reaped, once with each launcher, and then again with job control's process
+groups on (without a terminal to hand around, so it's just what the setpgid() and the signal resets cost). with -m every page of that
+much memory is touched first, so fork() has page tables to copy like it would in a shell that has grown, and the case names say so
+*/
+void benchSpawn(struct sigaction sa) {
+
+	const char* launcherNames[] = { "spawn", "fork", "spawn_pgroup", "fork_pgroup" };
+	enum launcherType launchers[] = { LAUNCH_SPAWN, LAUNCH_FORK, LAUNCH_SPAWN, LAUNCH_FORK };
+	int iterations = scaled(SPAWN_ITERATIONS);
+	long long* samples = malloc(sizeof(long long) * iterations);
+	char caseName[64];
+
+	char* ballast = NULL;
+	if (ballastMiB > 0) {
+		ballast = malloc(ballastMiB << 20);
+		if (ballast == NULL) {
+			perror("malloc()");
+			exit(EXIT_FAILURE);
+		}
+		memset(ballast, 1, ballastMiB << 20);
+	}
+
+	for (int l = 0; l < 4; l++) {
+		struct smallshArena arena = {0};
+		char line[] = "true";
+		int incomplete;
+		struct smallshCommand* command = smallshParseInput(line, &arena, &incomplete)->command;
+		struct smallshUsage usage;
+		int status;
+
+		launcherMode = launchers[l];
+		jobControl.enabled = (l >= 2);
+		double total = 0;
+		for (int i = 0; i < iterations; i++) {
+			long long start = monotonicNanos();
+			callExecForeground(command, &status, &usage, sa);
+			samples[i] = monotonicNanos() - start;
+			total += samples[i];
+		}
+		qsort(samples, iterations, sizeof(long long), compareSamples);
+
+		if (ballast != NULL) {
+			snprintf(caseName, sizeof(caseName), "%s_%ldMiB", launcherNames[l], ballastMiB);
+		}
+		else {
+			snprintf(caseName, sizeof(caseName), "%s", launcherNames[l]);
+		}
+		addResult("spawn", caseName, "mean", total / iterations / 1000.0, "us");
+		addResult("spawn", caseName, "median", samples[iterations / 2] / 1000.0, "us");
+		addResult("spawn", caseName, "p99", samples[(int)(iterations * 0.99)] / 1000.0, "us");
+
+		arenaReset(&arena);
+		free(arena.current);
+	}
+
+	launcherMode = LAUNCH_SPAWN;
+	jobControl.enabled = 0;
+	free(samples);
+	free(ballast);
+}
+
+
+/*	FUNCTION: benchReap
+starts a number of long running background jobs, then times how long a checkBackgroundPids() call takes while none of them are
+finishing, which is what every prompt costs. for comparison it also times the scan the old fixed PID array did, a waitpid(WNOHANG)
+on every live PID. the jobs are killed and reaped afterwards
+*/
+void benchReap(struct smallshJobTable* jobTable, struct sigaction sa) {
+
+	int liveCounts[] = { 0, 10, 200 };
+	int iterations = scaled(REAP_ITERATIONS);
+
+	for (int c = 0; c < 3; c++) {
+		struct smallshArena arena = {0};
+		char caseName[32];
+		int saved = silenceStdout();
+
+		for (int i = 0; i < liveCounts[c]; i++) {
+			char line[] = "sleep 1000 &";
+			int incomplete;
+			struct smallshCommand* command = smallshParseInput(line, &arena, &incomplete)->command;
+			callExecBackground(command, jobTable, sa);
+			arenaReset(&arena);
+		}
+
+		long long start = monotonicNanos();
+		for (int i = 0; i < iterations; i++) {
+			checkBackgroundPids(jobTable);
+		}
+		double pidfdNanos = (double)(monotonicNanos() - start) / iterations;
+
+		//the old way, one waitpid() per live PID per prompt
+		int status;
+		start = monotonicNanos();
+		for (int i = 0; i < iterations; i++) {
+			for (int j = 0; j < jobTable->jobCount; j++) {
+				waitpid(jobTable->jobs[j]->procs[0].pid, &status, WNOHANG);
+			}
+		}
+		double scanNanos = (double)(monotonicNanos() - start) / iterations;
+
+		for (int j = 0; j < jobTable->jobCount; j++) {
+			kill(jobTable->jobs[j]->procs[0].pid, SIGKILL);
+		}
+		while (jobTable->jobCount > 0) {
+			checkBackgroundPids(jobTable);
+		}
+		restoreStdout(saved);
+
+		snprintf(caseName, sizeof(caseName), "live_%d", liveCounts[c]);
+		addResult("reap", caseName, "epoll_check", pidfdNanos, "ns");
+		addResult("reap", caseName, "waitpid_scan", scanNanos, "ns");
+		free(arena.current);
+	}
+}
+
+
+/*	FUNCTION: benchGlobCase
+times expandCommand() on line, which should have a glob in it, iterations times and reports the average. the first run is reported on
+its own when the directory hasn't been read yet
+*/
+void benchGlobCase(const char* name, const char* line, int iterations) {
+
+	struct smallshArena arena = {0};
+	struct smallshContext context = {0};
+	context.arena = &arena;
+	int incomplete;
+	int argCount = 0;
+	long long total = 0;
+	for (int i = 0; i < iterations; i++) {
+		struct smallshArenaMark mark = arenaMark(&arena);
+		struct smallshNode* node = smallshParseInput(arenaStrndup(&arena, line, strlen(line)), &arena, &incomplete);
+		long long start = monotonicNanos();
+		expandCommand(node->command, &context);
+		total += monotonicNanos() - start;
+		argCount = node->command->argCount;
+		arenaRelease(&arena, mark);
+	}
+	addResult("glob", name, "us_per_glob", (total / 1000.0) / iterations, "us");
+	addResult("glob", name, "matches", argCount - 1, "args");
+	arenaReset(&arena);
+	free(arena.current);
+}
+
+
+void benchGlob() {
+
+	char directory[] = "/tmp/smallsh_bench_glob_XXXXXX";
+	if (mkdtemp(directory) == NULL) {
+		perror("mkdtemp()");
+		return;
+	}
+	int fileCount = scaled(GLOB_FILES);
+	char path[PATH_MAX];
+	for (int i = 0; i < fileCount; i++) {
+		snprintf(path, sizeof(path), "%s/file%06d.log", directory, i);
+		close(open(path, O_WRONLY | O_CREAT, 0644));
+	}
+	//a directory that was just changed gets read again every time, see GLOB_RACY_NANOS
+	usleep(2 * GLOB_RACY_NANOS / 1000);
+
+	char line[PATH_MAX + 16];
+	snprintf(line, sizeof(line), "echo %s/*5.log", directory);
+	benchGlobCase("suffix_cold", line, 1);
+	benchGlobCase("suffix_cached", line, scaled(GLOB_ITERATIONS));
+	snprintf(line, sizeof(line), "echo %s/file?0[0-4]*", directory);
+	benchGlobCase("general_cached", line, scaled(GLOB_ITERATIONS));
+	snprintf(line, sizeof(line), "echo %s/*", directory);
+	benchGlobCase("everything_cached", line, scaled(GLOB_ITERATIONS) / 10 + 1);
+
+	//glibc reads the directory every time
+	snprintf(line, sizeof(line), "%s/*5.log", directory);
+	int iterations = scaled(GLOB_ITERATIONS) / 10 + 1;
+	long long start = monotonicNanos();
+	for (int i = 0; i < iterations; i++) {
+		glob_t found;
+		glob(line, 0, NULL, &found);
+		globfree(&found);
+	}
+	addResult("glob", "suffix_libc_glob", "us_per_glob", ((monotonicNanos() - start) / 1000.0) / iterations, "us");
+
+	for (int i = 0; i < fileCount; i++) {
+		snprintf(path, sizeof(path), "%s/file%06d.log", directory, i);
+		unlink(path);
+	}
+	rmdir(directory);
+}
+
+
+/*	FUNCTION: benchScriptCase
+writes a generated script to a temp file and times the smallsh binary running it from start to exit. the script is either line 
+repeated lineCount times, or with asLoop a single for loop that runs line lineCount times
+*/
+void benchScriptCase(const char* smallshPath, const char* name, const char* line, int lineCount, int asLoop) {
+
+	char scriptPath[] = "/tmp/smallsh_bench_XXXXXX";
+	int fd = mkstemp(scriptPath);
+	if (fd == -1) {
+		perror("mkstemp()");
+		return;
+	}
+	FILE* script = fdopen(fd, "w");
+	if (asLoop) {
+		fprintf(script, "for i in");
+		for (int i = 0; i < lineCount; i++) {
+			fprintf(script, " %d", i);
+		}
+		fprintf(script, "; do %s; done\n", line);
+	}
+	else {
+		for (int i = 0; i < lineCount; i++) {
+			fprintf(script, "%s\n", line);
+		}
+	}
+	fclose(script);
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+	char* argv[] = { (char*)smallshPath, scriptPath, NULL };
+	pid_t pid;
+	int status = 0;
+	long long start = monotonicNanos();
+	if (posix_spawn(&pid, smallshPath, &actions, NULL, argv, environ) == 0) {
+		waitpid(pid, &status, 0);
+		long long elapsed = monotonicNanos() - start;
+		addResult("script", name, "commands_per_sec", lineCount / (elapsed / 1e9), "cmd/s");
+		addResult("script", name, "us_per_command", (elapsed / 1000.0) / lineCount, "us");
+	}
+	else {
+		fprintf(stderr, "couldn't run %s\n", smallshPath);
+	}
+
+	posix_spawn_file_actions_destroy(&actions);
+	unlink(scriptPath);
+}
+
+
+void benchScript(const char* smallshPath) {
+	int lineCount = scaled(SCRIPT_LINES);
+	benchScriptCase(smallshPath, "external_true", "/bin/true", lineCount, 0);
+	benchScriptCase(smallshPath, "builtin_true", "true", lineCount, 0);
+	benchScriptCase(smallshPath, "builtin_cd", "cd .", lineCount, 0);
+	benchScriptCase(smallshPath, "builtin_echo", "echo hello world", lineCount, 0);
+	benchScriptCase(smallshPath, "builtin_test", "[ 1 -lt 2 ]", lineCount, 0);
+	benchScriptCase(smallshPath, "comment", "# nothing to see here $$", lineCount, 0);
+	benchScriptCase(smallshPath, "list_and_or", "[ 1 -lt 2 ] && echo yes || echo no; true", lineCount, 0);
+	benchScriptCase(smallshPath, "loop_external_true", "/bin/true", lineCount, 1);
+	benchScriptCase(smallshPath, "loop_builtin_echo", "echo $i hello world", lineCount, 1);
+	benchScriptCase(smallshPath, "loop_builtin_test", "[ $i -lt 2 ]", lineCount, 1);
+	//what '$(...)' replaces, the value written to a file and read back by another program, next to capturing it through a pipe
+	benchScriptCase(smallshPath, "loop_tempfile_value", "/bin/echo $i > /tmp/smallsh_bench_value; /bin/cat /tmp/smallsh_bench_value", lineCount, 1);
+	benchScriptCase(smallshPath, "loop_subst_external", "echo $(/bin/echo $i)", lineCount, 1);
+	benchScriptCase(smallshPath, "loop_subst_builtin", "echo $(echo $i hello world)", lineCount, 1);
+	benchScriptCase(smallshPath, "loop_subst_nested", "echo $(echo $(printf %s $i))", lineCount, 1);
+	unlink("/tmp/smallsh_bench_value");
+	//a time limit adds a timerfd and a pidfd poll() to every launch
+	benchScriptCase(smallshPath, "external_true_timeout", "timeout 10 /bin/true", lineCount, 0);
+	//the same thing with the session trace on, the per-command cost includes writing the trace out at exit
+	setenv(TRACE_ENV_VAR, "/tmp/smallsh_bench_trace.json", 1);
+	benchScriptCase(smallshPath, "external_true_traced", "/bin/true", lineCount, 0);
+	benchScriptCase(smallshPath, "builtin_echo_traced", "echo hello world", lineCount, 0);
+	unsetenv(TRACE_ENV_VAR);
+	unlink("/tmp/smallsh_bench_trace.json");
+	//a background job's output thrown away, next to it kept in a ring for 'jobs -o'
+	benchScriptCase(smallshPath, "background_devnull", "/bin/echo $$ &", lineCount / 4, 0);
+	benchScriptCase(smallshPath, "background_joboutput", "set -o joboutput; /bin/echo $$ &", lineCount / 4, 0);
+}
+
+
+//prints the results in the requested format
+void printResults(const char* format) {
+	if (strcmp(format, "json") == 0) {
+		printf("[\n");
+		for (int i = 0; i < resultCount; i++) {
+			printf("  {\"benchmark\": \"%s\", \"case\": \"%s\", \"metric\": \"%s\", \"value\": %.3f, \"unit\": \"%s\"}%s\n",
+				results[i].benchmark, results[i].testCase, results[i].metric, results[i].value, results[i].unit, (i + 1 < resultCount) ? "," : "");
+		}
+		printf("]\n");
+	}
+	else {
+		printf("benchmark,case,metric,value,unit\n");
+		for (int i = 0; i < resultCount; i++) {
+			printf("%s,%s,%s,%.3f,%s\n", results[i].benchmark, results[i].testCase, results[i].metric, results[i].value, results[i].unit);
+		}
+	}
+}
+
+
+int main(int argc, char** argv) {
+
+	const char* format = "csv";
+	const char* smallshPath = "./smallsh";
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:s:n:m:")) != -1) {
+		switch (opt) {
+			case 'f':
+				format = optarg;
+				break;
+			case 's':
+				smallshPath = optarg;
+				break;
+			case 'n':
+				scale = atof(optarg);
+				break;
+			case 'm':
+				ballastMiB = atol(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-f csv|json] [-s path to smallsh] [-n scale] [-m MiB]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	//same signal setup the shell has, and none of the debug output
+	struct sigaction SIGINT_action = {0};
+	SIGINT_action.sa_handler = SIG_IGN;
+	sigfillset(&SIGINT_action.sa_mask);
+	SIGINT_action.sa_flags = SA_RESTART;
+	sigaction(SIGINT, &SIGINT_action, NULL);
+	unsetenv(ALLOC_STATS_ENV_VAR);
+	pidStringLen = snprintf(pidString, sizeof(pidString), "%d", getpid());
+
+	struct smallshJobTable jobTable;
+	jobTableInit(&jobTable, 0);
+	pathCacheInit(jobTable.epollFD);
+
+	benchParse();
+	benchSpawn(SIGINT_action);
+	benchReap(&jobTable, SIGINT_action);
+	benchGlob();
+	benchScript(smallshPath);
+
+	printResults(format);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,526 @@
+/***************************************************************************************
+* Program: SmallShell
+* Author: Lucas Moyle
+* Description: the builtins that stand in for programs, echo, printf, test/[, true and false.
+*	a script full of these used to cost a fork() and exec() per line just to print a string
+*	or compare two numbers, now they run right in the shell's process. they're in the builtin
+*	table in smallsh.c with the rest, which also takes care of their '<' and '>' redirects
+***************************************************************************************/
+
+#include "smallsh.h"
+
+
+//the parts of an expression call back into the whole thing for '( expression )'
+static int testExpression(char** arguments, int* position, int end);
+
+
+int smallshTrue(struct smallshCommand* inputCommand, struct smallshContext* context) {
+	return 0;
+}
+
+int smallshFalse(struct smallshCommand* inputCommand, struct smallshContext* context) {
+	return 1;
+}
+
+
+/*	FUNCTION: writeEscape
+prints the character for one backslash escape, sequence points just past the backslash. echo -e and printf's %b want octal written as
+'\0NNN' while a printf format takes '\NNN', that's what octalNeedsZero picks. '\c' sets stop, which means all output ends right there.
+returns a pointer to whatever comes after the escape
+*/
+static const char* writeEscape(const char* sequence, int octalNeedsZero, int* stop) {
+
+	int value;
+	int digits;
+
+	switch (*sequence) {
+		case 'a': putchar('\a'); return sequence + 1;
+		case 'b': putchar('\b'); return sequence + 1;
+		case 'e': putchar('\033'); return sequence + 1;
+		case 'f': putchar('\f'); return sequence + 1;
+		case 'n': putchar('\n'); return sequence + 1;
+		case 'r': putchar('\r'); return sequence + 1;
+		case 't': putchar('\t'); return sequence + 1;
+		case 'v': putchar('\v'); return sequence + 1;
+		case '\\': putchar('\\'); return sequence + 1;
+		case 'c':
+			*stop = 1;
+			return sequence + 1;
+		case 'x':
+			value = 0;
+			for (digits = 0; digits < 2 && isxdigit((unsigned char)sequence[digits + 1]); digits++) {
+				char digit = sequence[digits + 1];
+				value = (value * 16) + (isdigit((unsigned char)digit) ? digit - '0' : (tolower(digit) - 'a' + 10));
+			}
+			if (digits == 0) {
+				putchar('\\');
+				return sequence;
+			}
+			putchar(value);
+			return sequence + digits + 1;
+		case '\0':
+			putchar('\\');
+			return sequence;
+		default:
+			if (*sequence >= '0' && *sequence <= '7' && (!octalNeedsZero || *sequence == '0')) {
+				//the leading zero of '\0NNN' doesn't count towards the three digits
+				if (octalNeedsZero) {
+					sequence++;
+				}
+				value = 0;
+				for (digits = 0; digits < 3 && sequence[digits] >= '0' && sequence[digits] <= '7'; digits++) {
+					value = (value * 8) + (sequence[digits] - '0');
+				}
+				putchar(value & 0xff);
+				return sequence + digits;
+			}
+			//anything else isn't an escape, so the backslash gets printed like a normal character
+			putchar('\\');
+			return sequence;
+	}
+}
+
+
+/*	FUNCTION: smallshEcho
+built-in echo, works like the coreutils one: prints its arguments separated by spaces, -n leaves off the newline, -e turns on backslash
+escapes and -E turns them back off. an argument only counts as options if it's a '-' followed by nothing but those letters
+*/
+int smallshEcho(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	int newline = 1;
+	int escapes = 0;
+	int arg = 1;
+
+	for (; arg < inputCommand->argCount; arg++) {
+		char* option = inputCommand->arguments[arg];
+		if (option[0] != '-' || option[1] == '\0' || strspn(option + 1, "neE") != strlen(option + 1)) {
+			break;
+		}
+		for (option++; *option != '\0'; option++) {
+			if (*option == 'n') {
+				newline = 0;
+			}
+			else {
+				escapes = (*option == 'e');
+			}
+		}
+	}
+
+	for (int first = arg; arg < inputCommand->argCount; arg++) {
+		if (arg > first) {
+			putchar(' ');
+		}
+		if (!escapes) {
+			fputs(inputCommand->arguments[arg], stdout);
+			continue;
+		}
+		int stop = 0;
+		for (const char* c = inputCommand->arguments[arg]; *c != '\0' && !stop; ) {
+			if (*c == '\\') {
+				c = writeEscape(c + 1, 1, &stop);
+			}
+			else {
+				putchar(*c++);
+			}
+		}
+		if (stop) {
+			return 0;
+		}
+	}
+
+	if (newline) {
+		putchar('\n');
+	}
+	return 0;
+}
+
+
+/*	FUNCTION: printfNumber
+turns a printf argument into a number the way the printf program does: decimal, 0x hex or 0 octal, or the character code of whatever
+follows a leading quote. an empty argument is 0. returns -1 (after printing why) if the argument isn't a number, the value is still
+set to whatever could be read so printing can carry on like the real one does
+*/
+static int printfNumber(const char* arg, long long* valueOut) {
+
+	char* end;
+
+	if (arg[0] == '\'' || arg[0] == '"') {
+		*valueOut = (unsigned char)arg[1];
+		return 0;
+	}
+	if (arg[0] == '\0') {
+		*valueOut = 0;
+		return 0;
+	}
+
+	errno = 0;
+	*valueOut = strtoll(arg, &end, 0);
+	//strtoll() won't take a number bigger than LLONG_MAX, but %u and %x should be able to print anything up to ULLONG_MAX
+	if (errno == ERANGE && arg[0] != '-') {
+		errno = 0;
+		*valueOut = (long long)strtoull(arg, &end, 0);
+	}
+	if (end == arg || *end != '\0' || errno == ERANGE) {
+		fprintf(stderr, "printf: '%s': %s\n", arg, (errno == ERANGE) ? "value out of range" : "expected a numeric value");
+		return -1;
+	}
+	return 0;
+}
+
+
+/*	FUNCTION: smallshPrintf
+built-in printf, 'printf format [args...]'. the format gets the usual backslash escapes and %d %i %u %o %x %X %c %s %f %e %g %a
+conversions with flags, width and precision, plus %b which prints its argument with echo -e style escapes. like the real printf, if
+there are more arguments than conversions the format gets used again until they run out, and missing arguments count as empty.
+each conversion is handed to the C library's printf() once we've turned its argument into the right type
+*/
+int smallshPrintf(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	if (inputCommand->argCount < 2) {
+		fprintf(stderr, "usage: printf format [args...]\n");
+		return 2;
+	}
+
+	char* format = inputCommand->arguments[1];
+	int arg = 2;
+	int status = 0;
+	int stop = 0;
+
+	do {
+		int usedArgs = 0;
+
+		for (const char* c = format; *c != '\0' && !stop; ) {
+			if (*c == '\\') {
+				c = writeEscape(c + 1, 0, &stop);
+				continue;
+			}
+			if (*c != '%') {
+				putchar(*c++);
+				continue;
+			}
+			if (c[1] == '%') {
+				putchar('%');
+				c += 2;
+				continue;
+			}
+
+			//copy the flags, width and precision into a format of our own, then the length modifier that matches how we store the value
+			char spec[32];
+			size_t specLen = strspn(c + 1, "-+ #0");
+			specLen += strspn(c + 1 + specLen, "0123456789");
+			if (c[1 + specLen] == '.') {
+				specLen++;
+				specLen += strspn(c + 1 + specLen, "0123456789");
+			}
+			char conversion = c[1 + specLen];
+			if (conversion == '\0') {
+				fprintf(stderr, "printf: %s: missing conversion\n", c);
+				return 1;
+			}
+			if (specLen + 5 > sizeof(spec)) {
+				fprintf(stderr, "printf: %.*s: conversion too long\n", (int)specLen + 2, c);
+				return 1;
+			}
+			spec[0] = '%';
+			memcpy(spec + 1, c + 1, specLen);
+			c += specLen + 2;
+
+			char* value = "";
+			if (arg < inputCommand->argCount) {
+				value = inputCommand->arguments[arg++];
+				usedArgs++;
+			}
+
+			long long number;
+			switch (conversion) {
+				case 'd':
+				case 'i':
+					if (printfNumber(value, &number) == -1) {
+						status = 1;
+					}
+					strcpy(spec + specLen + 1, "lld");
+					printf(spec, number);
+					break;
+				case 'u':
+				case 'o':
+				case 'x':
+				case 'X':
+					if (printfNumber(value, &number) == -1) {
+						status = 1;
+					}
+					sprintf(spec + specLen + 1, "ll%c", conversion);
+					printf(spec, (unsigned long long)number);
+					break;
+				case 'f':
+				case 'F':
+				case 'e':
+				case 'E':
+				case 'g':
+				case 'G':
+				case 'a':
+				case 'A': {
+					char* end;
+					double real = strtod(value, &end);
+					if (value[0] != '\0' && (end == value || *end != '\0')) {
+						fprintf(stderr, "printf: '%s': expected a numeric value\n", value);
+						status = 1;
+					}
+					sprintf(spec + specLen + 1, "%c", conversion);
+					printf(spec, real);
+					break;
+				}
+				case 'c':
+					if (value[0] != '\0') {
+						strcpy(spec + specLen + 1, "c");
+						printf(spec, value[0]);
+					}
+					break;
+				case 's':
+					strcpy(spec + specLen + 1, "s");
+					printf(spec, value);
+					break;
+				case 'b':
+					for (const char* b = value; *b != '\0' && !stop; ) {
+						if (*b == '\\') {
+							b = writeEscape(b + 1, 1, &stop);
+						}
+						else {
+							putchar(*b++);
+						}
+					}
+					break;
+				default:
+					fprintf(stderr, "printf: %%%c: invalid conversion\n", conversion);
+					return 1;
+			}
+		}
+
+		//a format with no conversions in it can't use up the arguments, so don't go around forever
+		if (usedArgs == 0) {
+			break;
+		}
+	} while (arg < inputCommand->argCount && !stop);
+
+	return status;
+}
+
+
+//the integer arguments of -eq and friends have to be whole numbers, anything else is an error
+static int testInteger(const char* arg, long long* valueOut) {
+	char* end;
+	errno = 0;
+	*valueOut = strtoll(arg, &end, 10);
+	while (isspace((unsigned char)*end)) {
+		end++;
+	}
+	if (end == arg || *end != '\0' || errno == ERANGE) {
+		fprintf(stderr, "test: %s: integer expression expected\n", arg);
+		return -1;
+	}
+	return 0;
+}
+
+
+//the -e -f -d style tests, all the ones that look at a file
+static int testFile(char op, const char* path) {
+
+	struct stat info;
+
+	switch (op) {
+		case 'r': return access(path, R_OK) == 0;
+		case 'w': return access(path, W_OK) == 0;
+		case 'x': return access(path, X_OK) == 0;
+		case 'h':
+		case 'L': return lstat(path, &info) == 0 && S_ISLNK(info.st_mode);
+	}
+
+	if (stat(path, &info) == -1) {
+		return 0;
+	}
+	switch (op) {
+		case 'e': return 1;
+		case 'f': return S_ISREG(info.st_mode);
+		case 'd': return S_ISDIR(info.st_mode);
+		case 'b': return S_ISBLK(info.st_mode);
+		case 'c': return S_ISCHR(info.st_mode);
+		case 'p': return S_ISFIFO(info.st_mode);
+		case 'S': return S_ISSOCK(info.st_mode);
+		case 's': return info.st_size > 0;
+		case 'g': return (info.st_mode & S_ISGID) != 0;
+		case 'u': return (info.st_mode & S_ISUID) != 0;
+		case 'k': return (info.st_mode & S_ISVTX) != 0;
+		case 'O': return info.st_uid == geteuid();
+		case 'G': return info.st_gid == getegid();
+	}
+	return 0;
+}
+
+
+//true if op is one of the operators that go between two arguments
+static int testIsBinary(const char* op) {
+	static const char* binaryOps[] = { "=", "==", "!=", "-eq", "-ne", "-lt", "-le", "-gt", "-ge", "-nt", "-ot", "-ef", NULL };
+	for (int i = 0; binaryOps[i] != NULL; i++) {
+		if (strcmp(op, binaryOps[i]) == 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+/*	FUNCTION: testPrimary
+one test on its own: '( expression )', 'left op right', '-op argument' or just a string which is true if it isn't empty. a binary
+operator wins over a unary one, so 'test -n = -n' compares two strings. returns 1 for true, 0 for false and TEST_ERROR if the
+expression is bad. position is moved past whatever got used
+*/
+static int testPrimary(char** arguments, int* position, int end) {
+
+	if (*position >= end) {
+		fprintf(stderr, "test: argument expected\n");
+		return TEST_ERROR;
+	}
+
+	char* arg = arguments[*position];
+
+	if (strcmp(arg, "(") == 0 && *position + 1 < end) {
+		(*position)++;
+		int result = testExpression(arguments, position, end);
+		if (result == TEST_ERROR) {
+			return TEST_ERROR;
+		}
+		if (*position >= end || strcmp(arguments[*position], ")") != 0) {
+			fprintf(stderr, "test: ')' expected\n");
+			return TEST_ERROR;
+		}
+		(*position)++;
+		return result;
+	}
+
+	if (*position + 2 < end && testIsBinary(arguments[*position + 1])) {
+		char* op = arguments[*position + 1];
+		char* right = arguments[*position + 2];
+		*position += 3;
+
+		if (op[0] != '-') {
+			int same = (strcmp(arg, right) == 0);
+			return (op[0] == '!') ? !same : same;
+		}
+		if (strcmp(op, "-nt") == 0 || strcmp(op, "-ot") == 0 || strcmp(op, "-ef") == 0) {
+			struct stat leftInfo;
+			struct stat rightInfo;
+			int leftOK = (stat(arg, &leftInfo) == 0);
+			int rightOK = (stat(right, &rightInfo) == 0);
+			if (op[1] == 'e') {
+				return leftOK && rightOK && leftInfo.st_dev == rightInfo.st_dev && leftInfo.st_ino == rightInfo.st_ino;
+			}
+			//a file that doesn't exist is older than any file that does
+			if (!leftOK || !rightOK) {
+				return (op[1] == 'n') ? (leftOK && !rightOK) : (!leftOK && rightOK);
+			}
+			long long leftTime = (leftInfo.st_mtim.tv_sec * 1000000000LL) + leftInfo.st_mtim.tv_nsec;
+			long long rightTime = (rightInfo.st_mtim.tv_sec * 1000000000LL) + rightInfo.st_mtim.tv_nsec;
+			return (op[1] == 'n') ? (leftTime > rightTime) : (leftTime < rightTime);
+		}
+
+		long long left;
+		long long rightValue;
+		if (testInteger(arg, &left) == -1 || testInteger(right, &rightValue) == -1) {
+			return TEST_ERROR;
+		}
+		if (strcmp(op, "-eq") == 0) return left == rightValue;
+		if (strcmp(op, "-ne") == 0) return left != rightValue;
+		if (strcmp(op, "-lt") == 0) return left < rightValue;
+		if (strcmp(op, "-le") == 0) return left <= rightValue;
+		if (strcmp(op, "-gt") == 0) return left > rightValue;
+		return left >= rightValue;
+	}
+
+	if (arg[0] == '-' && arg[1] != '\0' && arg[2] == '\0' && strchr("bcdefghkLnOGprsStuwxz", arg[1]) != NULL && *position + 1 < end) {
+		char* operand = arguments[*position + 1];
+		*position += 2;
+		switch (arg[1]) {
+			case 'n': return operand[0] != '\0';
+			case 'z': return operand[0] == '\0';
+			case 't': {
+				long long fd;
+				if (testInteger(operand, &fd) == -1) {
+					return TEST_ERROR;
+				}
+				return isatty(fd);
+			}
+			default: return testFile(arg[1], operand);
+		}
+	}
+
+	(*position)++;
+	return arg[0] != '\0';
+}
+
+
+//'!' in front of a test flips it, and they can stack
+static int testNot(char** arguments, int* position, int end) {
+	if (*position + 1 < end && strcmp(arguments[*position], "!") == 0) {
+		(*position)++;
+		int result = testNot(arguments, position, end);
+		return (result == TEST_ERROR) ? TEST_ERROR : !result;
+	}
+	return testPrimary(arguments, position, end);
+}
+
+
+//tests joined with -a, which binds tighter than -o
+static int testAnd(char** arguments, int* position, int end) {
+	int result = testNot(arguments, position, end);
+	while (result != TEST_ERROR && *position < end && strcmp(arguments[*position], "-a") == 0) {
+		(*position)++;
+		int right = testNot(arguments, position, end);
+		result = (right == TEST_ERROR) ? TEST_ERROR : (result && right);
+	}
+	return result;
+}
+
+
+//a whole expression, which is tests joined with -o
+static int testExpression(char** arguments, int* position, int end) {
+	int result = testAnd(arguments, position, end);
+	while (result != TEST_ERROR && *position < end && strcmp(arguments[*position], "-o") == 0) {
+		(*position)++;
+		int right = testAnd(arguments, position, end);
+		result = (right == TEST_ERROR) ? TEST_ERROR : (result || right);
+	}
+	return result;
+}
+
+
+/*	FUNCTION: smallshTest
+built-in test and '[', checks files, strings and integers with the usual operators and exits 0 if the expression is true, 1 if it's
+false and 2 if it couldn't be understood. '[' is the same thing but its last argument has to be ']'. with one argument the answer is
+just whether it's empty, so 'test -n' is true like it is everywhere else
+*/
+int smallshTest(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	int end = inputCommand->argCount;
+	int position = 1;
+
+	if (strcmp(inputCommand->command, "[") == 0) {
+		if (strcmp(inputCommand->arguments[end - 1], "]") != 0) {
+			fprintf(stderr, "[: missing ']'\n");
+			return TEST_ERROR;
+		}
+		end--;
+	}
+
+	if (end == 1) {
+		return 1;
+	}
+	if (end == 2) {
+		return inputCommand->arguments[1][0] == '\0';
+	}
+
+	int result = testExpression(inputCommand->arguments, &position, end);
+	if (result != TEST_ERROR && position < end) {
+		fprintf(stderr, "test: %s: unexpected argument\n", inputCommand->arguments[position]);
+		return TEST_ERROR;
+	}
+	return (result == TEST_ERROR) ? TEST_ERROR : !result;
+}
@@ -0,0 +1,439 @@
+/***************************************************************************************
+* Program: SmallShell
+* Author: Lucas Moyle
+* Description: pathname expansion, '*', '?' and '[...]' in a word matched against the
+*	names in a directory. the lexer leaves GLOB_ markers where those were written unquoted
+*	and expandCommand() hands every word that has one to globWord() right before the
+*	command runs. directories are read with getdents64() in big batches and kept in a
+*	small cache keyed by their inode and mtime, so globbing the same big
+*	directory again only costs a stat() of it. d_type says which entries are directories,
+*	so nothing else gets stat()'d unless the file system doesn't fill it in. a glob only
+*	goes as deep as the pattern has components, there's no '**'
+***************************************************************************************/
+
+#include "smallsh.h"
+
+#define GLOB_MARKER_BYTES "\x03\x04\x05" //GLOB_STAR, GLOB_ONE and GLOB_BRACKET
+
+struct smallshGlobCache globCache = { .clock = 0 }; //global like the path cache, it lives as long as the shell does
+
+
+//the matches of one globWord(), allocated out of the line's arena
+struct globResults {
+	char** matches;
+	int count;
+	int capacity;
+	struct smallshArena* arena;
+};
+
+//how one component of a pattern gets matched. most globs are '*' and a suffix like '*.log' or a prefix and a '*', and those only need a
+//memcmp() against the end or the start of each name, everything else goes through globMatch()
+enum globKind { GLOB_GENERAL, GLOB_SUFFIX, GLOB_PREFIX };
+struct globPattern {
+	const char* text; //the whole component for GLOB_GENERAL, the literal part otherwise
+	size_t length; //the length of the literal part
+	enum globKind kind;
+};
+
+
+//the character a glob marker was written as
+static inline char globPlain(char c) {
+	return (c == GLOB_STAR) ? '*' : (c == GLOB_ONE) ? '?' : (c == GLOB_BRACKET) ? '[' : c;
+}
+
+
+//true if the word has any glob markers in it
+int globHasMarks(const char* word) {
+	return strpbrk(word, GLOB_MARKER_BYTES) != NULL;
+}
+
+
+//turns the glob markers in a word back into the characters they were, in place, for a glob that matched nothing or one that shouldn't be matched at all
+void globLiteral(char* word) {
+	for (char* c = strpbrk(word, GLOB_MARKER_BYTES); c != NULL; c = strpbrk(c + 1, GLOB_MARKER_BYTES)) {
+		*c = globPlain(*c);
+	}
+}
+
+
+/*	FUNCTION: globBracket
+matches c against the bracket expression right after a GLOB_BRACKET, like '[abc]', '[a-z]' or '[!0-9]' ('^' works like '!' too). a ']'
+right at the start is one of the characters instead of the end. *end gets set past the closing ']'. returns 1 if c is in the set (or isn't,
+with a '!'), 0 if not and -1 if there's no closing ']', in which case the '[' is just a '['
+*/
+static int globBracket(const char* set, char c, const char** end) {
+
+	int negate = (*set == '!' || *set == '^');
+	const char* p = set + negate;
+	int matched = 0;
+	do {
+		if (*p == '\0') {
+			return -1;
+		}
+		unsigned char low = globPlain(*p);
+		unsigned char high = low;
+		if (p[1] == '-' && p[2] != ']' && p[2] != '\0') {
+			high = globPlain(p[2]);
+			p += 2;
+		}
+		if ((unsigned char)c >= low && (unsigned char)c <= high) {
+			matched = 1;
+		}
+		p++;
+	} while (*p != ']');
+
+	*end = p + 1;
+	return matched != negate;
+}
+
+
+/*	FUNCTION: globMatch
+true if name matches the pattern (one component, with glob markers in it). a '*' remembers where it was, and when something after it fails
+to match the pattern goes back there with the '*' taking one more character, so it never backtracks further than the last '*'. the rule
+about names starting with '.' is up to the caller
+*/
+static int globMatch(const char* pattern, const char* name) {
+
+	const char* star = NULL;
+	const char* starName = NULL;
+	while (*name != '\0') {
+		const char* next = pattern + 1;
+		int matched;
+		if (*pattern == GLOB_STAR) {
+			star = ++pattern;
+			starName = name;
+			continue;
+		}
+		else if (*pattern == GLOB_ONE) {
+			matched = 1;
+		}
+		else if (*pattern == GLOB_BRACKET) {
+			matched = globBracket(pattern + 1, *name, &next);
+			if (matched == -1) {
+				matched = (*name == '[');
+			}
+		}
+		else {
+			matched = (*pattern == *name);
+		}
+
+		if (matched) {
+			pattern = next;
+			name++;
+		}
+		else if (star != NULL) {
+			pattern = star;
+			name = ++starName;
+		}
+		else {
+			return 0;
+		}
+	}
+	while (*pattern == GLOB_STAR) {
+		pattern++;
+	}
+	return *pattern == '\0';
+}
+
+
+//works out how a component gets matched, see struct globPattern
+static void globCompile(struct globPattern* compiled, const char* component) {
+
+	const char* first = strpbrk(component, GLOB_MARKER_BYTES);
+	size_t length = strlen(component);
+	compiled->kind = GLOB_GENERAL;
+	compiled->text = component;
+	compiled->length = length;
+	if (first == component && *first == GLOB_STAR && strpbrk(first + 1, GLOB_MARKER_BYTES) == NULL) {
+		compiled->kind = GLOB_SUFFIX;
+		compiled->text = component + 1;
+		compiled->length = length - 1;
+	}
+	else if (first == component + length - 1 && *first == GLOB_STAR) {
+		compiled->kind = GLOB_PREFIX;
+		compiled->length = length - 1;
+	}
+}
+
+
+//true if an entry of a listing matches a compiled component
+static inline int globMatchEntry(struct globPattern* compiled, const char* name, size_t length) {
+	if (compiled->kind == GLOB_SUFFIX) {
+		return length >= compiled->length && memcmp(name + length - compiled->length, compiled->text, compiled->length) == 0;
+	}
+	if (compiled->kind == GLOB_PREFIX) {
+		return length >= compiled->length && memcmp(name, compiled->text, compiled->length) == 0;
+	}
+	return globMatch(compiled->text, name);
+}
+
+
+//qsort_r() comparison for a listing's entries, arg is the listing's names
+static int globCompareEntries(const void* a, const void* b, void* names) {
+	return strcmp((char*)names + ((const struct smallshDirEntry*)a)->offset, (char*)names + ((const struct smallshDirEntry*)b)->offset);
+}
+
+//qsort() comparison for matches
+static int globCompareMatches(const void* a, const void* b) {
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+
+/*	FUNCTION: globRead
+reads the directory at path into a listing. the mtime comes from the open directory before any of it is read, so if it changes while
+it's being read the listing already looks out of date the next time. returns 0, or -1 if it can't be read
+*/
+static int globRead(struct smallshDirListing* listing, const char* path) {
+
+	if (globCache.buffer == NULL) {
+		globCache.buffer = malloc(GLOB_DIRENT_BUFFER);
+		if (globCache.buffer == NULL) {
+			perror("malloc()");
+			exit(1);
+		}
+	}
+
+	int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1) {
+		return -1;
+	}
+	struct stat info;
+	struct timespec now;
+	if (fstat(fd, &info) == -1) {
+		close(fd);
+		return -1;
+	}
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	size_t namesCapacity = 4096;
+	size_t namesLength = 0;
+	int capacity = 64;
+	int count = 0;
+	char* names = malloc(namesCapacity);
+	struct smallshDirEntry* entries = malloc(sizeof(struct smallshDirEntry) * capacity);
+	if (names == NULL || entries == NULL) {
+		perror("malloc()");
+		exit(1);
+	}
+
+	ssize_t got;
+	while ((got = getdents64(fd, globCache.buffer, GLOB_DIRENT_BUFFER)) > 0) {
+		for (ssize_t offset = 0; offset < got; ) {
+			struct dirent64* entry = (struct dirent64*)(globCache.buffer + offset);
+			offset += entry->d_reclen;
+			const char* name = entry->d_name;
+			if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+				continue;
+			}
+
+			size_t length = strlen(name);
+			if (namesLength + length + 1 > namesCapacity) {
+				namesCapacity *= 2;
+				names = realloc(names, namesCapacity);
+			}
+			if (count == capacity) {
+				capacity *= 2;
+				entries = realloc(entries, sizeof(struct smallshDirEntry) * capacity);
+			}
+			if (names == NULL || entries == NULL) {
+				perror("realloc()");
+				exit(1);
+			}
+			memcpy(names + namesLength, name, length + 1);
+			entries[count].offset = namesLength;
+			entries[count].length = length;
+			entries[count].type = entry->d_type;
+			namesLength += length + 1;
+			count++;
+		}
+	}
+	close(fd);
+	if (got == -1) {
+		free(names);
+		free(entries);
+		return -1;
+	}
+
+	listing->device = info.st_dev;
+	listing->inode = info.st_ino;
+	listing->modified = info.st_mtim;
+	listing->racy = ((now.tv_sec - info.st_mtim.tv_sec) * 1000000000LL + (now.tv_nsec - info.st_mtim.tv_nsec)) < GLOB_RACY_NANOS;
+	listing->entries = entries;
+	listing->count = count;
+	listing->names = names;
+	listing->sorted = 0;
+	listing->uses = 0;
+	return 0;
+}
+
+
+/*	FUNCTION: globListDirectory
+returns the listing of the directory at path, from the cache if it's there and the directory's mtime hasn't changed since. a listing
+that was read right when the directory changed (see GLOB_RACY_NANOS) can't be trusted, so it's read again. otherwise the slot that's gone
+longest without being used gets the new listing. returns NULL if path isn't a directory we can read
+*/
+static struct smallshDirListing* globListDirectory(const char* path) {
+
+	struct stat info;
+	if (stat(path, &info) == -1 || !S_ISDIR(info.st_mode)) {
+		return NULL;
+	}
+
+	globCache.clock++;
+	struct smallshDirListing* found = NULL;
+	struct smallshDirListing* victim = NULL;
+	for (int i = 0; i < GLOB_CACHE_SLOTS; i++) {
+		struct smallshDirListing* listing = &globCache.slots[i];
+		if (listing->entries != NULL && listing->device == info.st_dev && listing->inode == info.st_ino) {
+			found = listing;
+			break;
+		}
+		if (listing->pinned == 0 && (victim == NULL || (victim->entries != NULL && (listing->entries == NULL || listing->lastUsed < victim->lastUsed)))) {
+			victim = listing;
+		}
+	}
+
+	//a listing that a glob further up is still walking can't be freed, even if it's out of date (which takes a symlink loop)
+	if (found != NULL && (found->pinned > 0 || (!found->racy && found->modified.tv_sec == info.st_mtim.tv_sec && found->modified.tv_nsec == info.st_mtim.tv_nsec))) {
+		found->lastUsed = globCache.clock;
+		return found;
+	}
+
+	struct smallshDirListing* listing = (found != NULL) ? found : victim;
+	if (listing == NULL) {
+		return NULL;
+	}
+	free(listing->entries);
+	free(listing->names);
+	listing->entries = NULL;
+	listing->names = NULL;
+	if (globRead(listing, path) == -1) {
+		return NULL;
+	}
+	listing->lastUsed = globCache.clock;
+	return listing;
+}
+
+
+//adds a path to the matches, copied into the arena
+static void globAdd(struct globResults* results, const char* path, size_t length) {
+	if (results->count == results->capacity) {
+		results->capacity = (results->capacity == 0) ? INITIAL_ARGUMENTS : results->capacity * 2;
+		char** grown = arenaAlloc(results->arena, sizeof(char*) * results->capacity);
+		if (results->count > 0) {
+			memcpy(grown, results->matches, sizeof(char*) * results->count);
+		}
+		results->matches = grown;
+	}
+	results->matches[results->count++] = arenaStrndup(results->arena, path, length);
+}
+
+
+//true if an entry is a directory (or a symlink to one). d_type usually says so, only symlinks and file systems that don't fill it in need a stat()
+static int globIsDirectory(char* path, size_t length, struct smallshDirEntry* entry) {
+	if (entry->type == DT_DIR) {
+		return 1;
+	}
+	if (entry->type != DT_LNK && entry->type != DT_UNKNOWN) {
+		return 0;
+	}
+	struct stat info;
+	path[length] = '\0';
+	int isDirectory = (stat(path, &info) == 0 && S_ISDIR(info.st_mode));
+	//what a name is can't change without the directory's mtime changing, but where a symlink points can
+	if (entry->type == DT_UNKNOWN) {
+		entry->type = isDirectory ? DT_DIR : DT_REG;
+	}
+	return isDirectory;
+}
+
+
+/*	FUNCTION: globComponents
+matches the rest of a pattern, starting at one of its components, against what's under path (the first length bytes of it, ending in
+a '/' unless it's empty). a component without a glob is just added to the path. one with a glob gets the directory's listing and goes
+on with every entry that matches, which has to be a directory if there are more components after it. names starting with '.' only match
+a component that starts with a '.' too
+*/
+static void globComponents(struct globResults* results, char* path, size_t length, const char* pattern) {
+
+	const char* slash = strchr(pattern, '/');
+	size_t componentLength = (slash != NULL) ? (size_t)(slash - pattern) : strlen(pattern);
+	if (length + componentLength + 2 > PATH_MAX) {
+		return;
+	}
+	char component[componentLength + 1];
+	memcpy(component, pattern, componentLength);
+	component[componentLength] = '\0';
+
+	if (strpbrk(component, GLOB_MARKER_BYTES) == NULL) {
+		memcpy(path + length, component, componentLength);
+		length += componentLength;
+		if (slash != NULL) {
+			path[length++] = '/';
+			globComponents(results, path, length, slash + 1);
+			return;
+		}
+		//the end of a pattern that had a glob somewhere before this, so the path only counts if it's really there
+		struct stat info;
+		path[length] = '\0';
+		if (lstat(path, &info) == 0) {
+			globAdd(results, path, length);
+		}
+		return;
+	}
+
+	path[length] = '\0';
+	struct smallshDirListing* listing = globListDirectory((length > 0) ? path : ".");
+	if (listing == NULL) {
+		return;
+	}
+
+	//a listing being walked further up can't be reordered under it
+	if (!listing->sorted && listing->uses > 0 && listing->pinned == 0) {
+		qsort_r(listing->entries, listing->count, sizeof(struct smallshDirEntry), globCompareEntries, listing->names);
+		listing->sorted = 1;
+	}
+	listing->uses++;
+
+	struct globPattern compiled;
+	globCompile(&compiled, component);
+	int matchDots = (component[0] == '.');
+	int first = results->count;
+	listing->pinned++;
+	for (int i = 0; i < listing->count; i++) {
+		struct smallshDirEntry* entry = &listing->entries[i];
+		const char* name = listing->names + entry->offset;
+		if ((name[0] == '.' && !matchDots) || !globMatchEntry(&compiled, name, entry->length)) {
+			continue;
+		}
+		if (length + entry->length + 2 > PATH_MAX) {
+			continue;
+		}
+		memcpy(path + length, name, entry->length);
+		if (slash == NULL) {
+			globAdd(results, path, length + entry->length);
+		}
+		else if (globIsDirectory(path, length + entry->length, entry)) {
+			path[length + entry->length] = '/';
+			globComponents(results, path, length + entry->length + 1, slash + 1);
+		}
+	}
+	listing->pinned--;
+	if (!listing->sorted) {
+		qsort(results->matches + first, results->count - first, sizeof(char*), globCompareMatches);
+	}
+}
+
+
+/*	FUNCTION: globWord
+matches a word with glob markers in it against the file system. the matches come back as an arena array of arena strings, sorted, with matchCount set to how many there are. there's no limit on how many, expandCommand() grows the argument array to fit.
+returns NULL with matchCount 0 if nothing matched, and then the word stays as it was written like it does in sh
+*/
+char** globWord(const char* word, struct smallshArena* arena, int* matchCount) {
+
+	struct globResults results = { NULL, 0, 0, arena };
+	char path[PATH_MAX];
+	globComponents(&results, path, 0, word);
+	*matchCount = results.count;
+	return results.matches;
+}
@@ -0,0 +1,399 @@
+/***************************************************************************************
+* Program: SmallShell
+* Author: Lucas Moyle
+* Description: job control. when the shell is interactive every pipeline gets a process
+*	group of its own and the foreground one is handed the terminal, so ^C and ^Z go to it
+*	and never to the shell. a pipeline that gets stopped goes into the job table like a
+*	background job would, where 'fg' brings it back, 'bg' keeps it running in the background
+*	and 'kill %n' signals it. stops are found out about with waitpid(WUNTRACED) when the
+*	shell's waiting on a foreground pipeline, and through a SIGCHLD signalfd in the job
+*	table's epoll set otherwise, since a pidfd only says when a process exits
+***************************************************************************************/
+
+#include "smallsh.h"
+
+
+struct smallshJobControl jobControl = { 0, -1, 0, 0, {0}, -1, 0, NULL }; //global like the job output set, the launcher and every wait need it. off until jobControlInit()
+
+
+/*	FUNCTION: jobControlInit
+takes over the terminal for an interactive shell the way other shells do. if the shell was started in the background it stops itself
+until it's brought to the foreground, then it goes in a process group of its own and takes the terminal. the shell ignores the stop
+signals from then on (^Z is for its jobs now, 'set -o fgonly' is the foreground-only toggle instead), and blocks SIGCHLD so it can be
+read from a signalfd in the job table's epoll set. if any of it doesn't work the shell just goes on without job control
+*/
+void jobControlInit(struct smallshJobTable* jobTable) {
+
+	pid_t group;
+	while (tcgetpgrp(STDIN_FILENO) != (group = getpgrp())) {
+		if (tcgetpgrp(STDIN_FILENO) == -1) {
+			return;
+		}
+		kill(-group, SIGTTIN);
+	}
+
+	struct sigaction ignore = {0};
+	ignore.sa_handler = SIG_IGN;
+	sigaction(SIGTSTP, &ignore, NULL);
+	sigaction(SIGTTIN, &ignore, NULL);
+	sigaction(SIGTTOU, &ignore, NULL);
+
+	//a session leader (like a shell started by a terminal emulator) already has a group of its own and can't make a new one
+	jobControl.originalGroup = group;
+	setpgid(0, 0);
+	jobControl.shellGroup = getpgrp();
+	jobControl.terminalFD = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, REDIRECT_HIGH_FD);
+	if (jobControl.terminalFD == -1 || tcsetpgrp(jobControl.terminalFD, jobControl.shellGroup) == -1) {
+		perror("smallsh: job control");
+		if (jobControl.terminalFD != -1) {
+			close(jobControl.terminalFD);
+			jobControl.terminalFD = -1;
+		}
+		return;
+	}
+	tcgetattr(jobControl.terminalFD, &jobControl.shellModes);
+
+	sigset_t childSignals;
+	sigemptyset(&childSignals);
+	sigaddset(&childSignals, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &childSignals, NULL);
+	jobControl.signalFD = signalfd(-1, &childSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (jobControl.signalFD != -1) {
+		struct epoll_event event = {0};
+		event.events = EPOLLIN;
+		event.data.ptr = &jobControl;
+		if (epoll_ctl(jobTable->epollFD, EPOLL_CTL_ADD, jobControl.signalFD, &event) == -1) {
+			close(jobControl.signalFD);
+			jobControl.signalFD = -1;
+		}
+	}
+
+	jobControl.jobTable = jobTable;
+	jobControl.enabled = 1;
+}
+
+
+//gives the terminal back to the process group the shell was started in, so whatever started the shell can use it again once it exits
+void jobControlEnd() {
+	if (jobControl.enabled && jobControl.terminalFD != -1) {
+		tcsetpgrp(jobControl.terminalFD, jobControl.originalGroup);
+	}
+}
+
+
+//hands the terminal to a job's process group for 'fg', a new foreground pipeline takes it itself as it launches
+static void jobControlGiveTerminal(pid_t group) {
+	if (jobControl.enabled && jobControl.terminalFD != -1 && group > 0) {
+		tcsetpgrp(jobControl.terminalFD, group);
+	}
+}
+
+
+//takes the terminal back once a foreground pipeline is done or stopped, and puts its settings back if the pipeline could have left them changed
+void jobControlReclaim(int restoreModes) {
+	if (!jobControl.enabled || jobControl.terminalFD == -1) {
+		return;
+	}
+	tcsetpgrp(jobControl.terminalFD, jobControl.shellGroup);
+	if (restoreModes) {
+		tcsetattr(jobControl.terminalFD, TCSADRAIN, &jobControl.shellModes);
+	}
+}
+
+
+//empties the SIGCHLD signalfd, what the signals were about gets asked of waitpid() instead since several SIGCHLDs can become one
+void jobControlDrain() {
+	struct signalfd_siginfo signals[16];
+	if (jobControl.signalFD != -1) {
+		while (read(jobControl.signalFD, signals, sizeof(signals)) > 0);
+	}
+}
+
+
+/*	FUNCTION: jobSignal
+sends a signal to every process of a job. a job with a process group gets one killpg(), one without (it was started before job control,
+or without it) gets it sent to each process that's still running. returns -1 with errno set if it couldn't be sent
+*/
+int jobSignal(struct smallshJob* job, int signal) {
+
+	if (job->group > 0) {
+		return killpg(job->group, signal);
+	}
+	int result = 0;
+	for (int proc = 0; proc < job->procCount; proc++) {
+		struct smallshProcess* process = &job->procs[proc];
+		if (process->done) {
+			continue;
+		}
+		if (process->pidfd == -1 || pidfd_send_signal(process->pidfd, signal, NULL, 0) == -1) {
+			result |= kill(process->pid, signal);
+		}
+	}
+	return result;
+}
+
+
+//prints that a job stopped, on a line of its own. a foreground one was stopped by a ^Z that the terminal echoed, so that's moved past too
+static void reportStopped(struct smallshJobTable* jobTable, struct smallshJob* job, int foreground) {
+
+	if (jobTable->promptShowing || foreground) {
+		printf("\n");
+		jobTable->promptShowing = 0;
+	}
+	printf("[%d] Stopped   %s\n", job->id, job->commandLine);
+	fflush(stdout);
+}
+
+
+/*	FUNCTION: jobStopsCheck
+called when the signalfd says there's been a SIGCHLD. it might have been a process exiting, which its pidfd takes care of, so this only
+asks waitid() about processes that stopped or were continued since the last time, which costs nothing more than a syscall when none
+were. a background job that stops (say it tried to read the terminal) gets reported the moment it does, and one that's continued by
+something else than 'bg' goes back to running
+*/
+void jobStopsCheck(struct smallshJobTable* jobTable) {
+
+	jobControlDrain();
+	jobControl.stopsPending = 0;
+
+	siginfo_t info;
+	while (1) {
+		info.si_pid = 0;
+		if (waitid(P_ALL, 0, &info, WSTOPPED | WCONTINUED | WNOHANG) == -1 || info.si_pid == 0) {
+			break;
+		}
+		struct smallshProcess* process = findProcess(jobTable, info.si_pid);
+		if (process == NULL) {
+			continue;
+		}
+		struct smallshJob* job = process->job;
+		if (info.si_code == CLD_CONTINUED) {
+			job->stopped = 0;
+		}
+		else if (!job->stopped) {
+			job->stopped = info.si_status;
+			traceEvent("stopped", -1, job->traceTrack, info.si_pid, -1);
+			reportStopped(jobTable, job, 0);
+		}
+	}
+}
+
+
+/*	FUNCTION: stopForegroundJob
+turns what's left of a foreground pipeline that got stopped into a stopped job in the job table: pids are its processes from the one
+that stopped on (the ones before it are already reaped) and signal is what stopped it. a pipeline that 'fg' brought back keeps the job number it had, id is 0 for a
+new one. the time it has left and what it's cost so far go with it, deadline is left without a timer. returns the job, or NULL if there's
+no job table to put it in
+*/
+struct smallshJob* stopForegroundJob(pid_t* pids, int count, int signal, const char* commandLine, int id, struct smallshDeadline* deadline, struct smallshUsage* usage, int track, long long startNanos) {
+
+	struct smallshJobTable* jobTable = jobControl.jobTable;
+	if (jobTable == NULL) {
+		return NULL;
+	}
+	pid_t group = getpgid(pids[0]);
+	struct smallshJob* job = addJob(jobTable, pids, count, commandLine);
+	if (job == NULL) {
+		return NULL;
+	}
+
+	//the shell's own group would get the shell signaled along with the job, that can only happen if setpgid() didn't work
+	job->group = (group > 0 && group != jobControl.shellGroup) ? group : 0;
+	job->stopped = signal;
+	if (id != 0) {
+		job->id = id;
+		if (jobTable->nextJobId <= id) {
+			jobTable->nextJobId = id + 1;
+		}
+	}
+	job->startNanos = startNanos;
+	job->traceTrack = track;
+	job->usage = *usage;
+	job->deadline = *deadline;
+	deadline->timerFD = -1;
+	jobDeadlineWatch(jobTable, job);
+
+	reportStopped(jobTable, job, 1);
+	return job;
+}
+
+
+/*	FUNCTION: findJobSpec
+finds the job a 'fg', 'bg' or 'kill' argument names: '%n' (or just 'n' for fg and bg) is job number n, and nothing, '%', '%%' or '%+'
+is the current job, which is the newest stopped one or the newest one if none are stopped. prints why and returns NULL if there's no
+such job
+*/
+static struct smallshJob* findJobSpec(struct smallshJobTable* jobTable, const char* spec, const char* builtinName) {
+
+	if (spec == NULL || strcmp(spec, "%") == 0 || strcmp(spec, "%%") == 0 || strcmp(spec, "%+") == 0) {
+		for (int i = jobTable->jobCount - 1; i >= 0; i--) {
+			if (jobTable->jobs[i]->stopped) {
+				return jobTable->jobs[i];
+			}
+		}
+		if (jobTable->jobCount > 0) {
+			return jobTable->jobs[jobTable->jobCount - 1];
+		}
+		fprintf(stderr, "%s: no current job\n", builtinName);
+		return NULL;
+	}
+
+	const char* number = (spec[0] == '%') ? spec + 1 : spec;
+	char* end;
+	long id = strtol(number, &end, 10);
+	for (int i = 0; i < jobTable->jobCount && end != number && *end == '\0'; i++) {
+		if (jobTable->jobs[i]->id == id) {
+			return jobTable->jobs[i];
+		}
+	}
+	fprintf(stderr, "%s: %s: no such job\n", builtinName, spec);
+	return NULL;
+}
+
+
+/*	FUNCTION: smallshFg
+built-in fg command, 'fg [%n]' continues a job in the foreground. the job comes out of the job table and is waited for just like a
+pipeline that was launched in the foreground (see waitPipeline()), with the terminal, the time limit it had left and what it's cost so
+far. if it gets stopped again it goes back in with the same job number
+*/
+int smallshFg(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	struct smallshJobTable* jobTable = context->jobTable;
+	struct smallshJob* job = findJobSpec(jobTable, (inputCommand->argCount > 1) ? inputCommand->arguments[1] : NULL, "fg");
+	if (job == NULL) {
+		return 1;
+	}
+
+	//stages that already finished keep their status for the pipeline's, the rest stop being watched by the job table
+	int count = job->procCount;
+	pid_t pids[count];
+	int statuses[count];
+	for (int proc = 0; proc < count; proc++) {
+		struct smallshProcess* process = &job->procs[proc];
+		pids[proc] = process->done ? -1 : process->pid;
+		statuses[proc] = process->status;
+		if (!process->done) {
+			unwatchProcess(jobTable, process);
+		}
+	}
+	char* commandLine = job->commandLine;
+	job->commandLine = NULL;
+	int id = job->id;
+	pid_t group = job->group;
+	int track = job->traceTrack;
+	long long startNanos = job->startNanos;
+	struct smallshDeadline deadline;
+	jobDeadlineTake(job, &deadline);
+	context->lastUsage = job->usage;
+	removeJob(jobTable, job);
+
+	printf("%s\n", commandLine);
+	fflush(stdout);
+	jobControlGiveTerminal(group);
+	if (group > 0) {
+		killpg(group, SIGCONT);
+	}
+	else {
+		for (int proc = 0; proc < count; proc++) {
+			if (pids[proc] != -1) {
+				kill(pids[proc], SIGCONT);
+			}
+		}
+	}
+
+	int stopped = waitPipeline(pids, statuses, count, &context->childStatus, &context->lastUsage, &deadline, track);
+	if (stopped != -1) {
+		stopForegroundJob(pids + stopped, count - stopped, WEXITSTATUS(context->childStatus) - 128, commandLine, id, &deadline, &context->lastUsage, track, startNanos);
+	}
+	context->lastUsage.wallNanos = monotonicNanos() - startNanos;
+	context->timedOut = (deadline.expired > 0);
+	deadlineStop(&deadline);
+	free(commandLine);
+	return BUILTIN_KEEP_STATUS;
+}
+
+
+//built-in bg command, 'bg [%n]' continues a stopped job in the background
+int smallshBg(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	struct smallshJob* job = findJobSpec(context->jobTable, (inputCommand->argCount > 1) ? inputCommand->arguments[1] : NULL, "bg");
+	if (job == NULL) {
+		return 1;
+	}
+	if (!job->stopped) {
+		fprintf(stderr, "bg: job %d is already running in the background\n", job->id);
+		return 0;
+	}
+	if (jobSignal(job, SIGCONT) == -1) {
+		fprintf(stderr, "bg: %d: %s\n", job->id, strerror(errno));
+		return 1;
+	}
+	job->stopped = 0;
+	printf("[%d] %s &\n", job->id, job->commandLine);
+	return 0;
+}
+
+
+/*	FUNCTION: smallshKill
+built-in kill command, 'kill [-s SIGNAL | -SIGNAL] target...' sends SIGNAL (TERM by default, a name or a number) to each target, which
+is a PID or a job like '%1'. a job gets it in its whole process group at once. a stopped job couldn't act on it until it was continued,
+so unless the signal is one that stops or continues it gets a SIGCONT right after, like it does in bash. it's a builtin so '%n' works,
+backgrounded or in a pipeline the real kill program gets run
+*/
+int smallshKill(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	int signal = SIGTERM;
+	int i = 1;
+	char* signalName = NULL;
+	if (i + 1 < inputCommand->argCount && strcmp(inputCommand->arguments[i], "-s") == 0) {
+		signalName = inputCommand->arguments[i + 1];
+		i += 2;
+	}
+	else if (i < inputCommand->argCount && inputCommand->arguments[i][0] == '-' && inputCommand->arguments[i][1] != '\0') {
+		signalName = inputCommand->arguments[i] + 1;
+		i++;
+	}
+	//signal 0 only checks that the target exists, which is a kill thing but not something 'timeout' could send
+	if (signalName != NULL) {
+		signal = (strcmp(signalName, "0") == 0) ? 0 : parseSignal(signalName);
+	}
+	if (signal == -1) {
+		fprintf(stderr, "kill: %s: invalid signal\n", signalName);
+		return 1;
+	}
+	if (i == inputCommand->argCount) {
+		fprintf(stderr, "usage: kill [-s SIGNAL | -SIGNAL] %%job|pid...\n");
+		return 2;
+	}
+
+	int result = 0;
+	for (; i < inputCommand->argCount; i++) {
+		char* target = inputCommand->arguments[i];
+		if (target[0] == '%') {
+			struct smallshJob* job = findJobSpec(context->jobTable, target, "kill");
+			if (job == NULL) {
+				result = 1;
+			}
+			else if (jobSignal(job, signal) == -1) {
+				fprintf(stderr, "kill: %s: %s\n", target, strerror(errno));
+				result = 1;
+			}
+			else if (job->stopped && signal != SIGCONT && signal != SIGSTOP && signal != SIGTSTP && signal != SIGTTIN && signal != SIGTTOU) {
+				jobSignal(job, SIGCONT);
+			}
+			continue;
+		}
+
+		char* end;
+		long pid = strtol(target, &end, 10);
+		if (end == target || *end != '\0') {
+			fprintf(stderr, "kill: %s: arguments must be process or job IDs\n", target);
+			result = 1;
+		}
+		else if (kill(pid, signal) == -1) {
+			fprintf(stderr, "kill: (%ld) - %s\n", pid, strerror(errno));
+			result = 1;
+		}
+	}
+	return result;
+}
@@ -0,0 +1,866 @@
+/***************************************************************************************
+* Program: SmallShell
+* Author: Lucas Moyle
+* Description: the lexer that turns an input line into words and operators for
+*	smallshParseInput(), and the expansion of $VAR, $?, $!, $$, $(...) and globs right before a command runs.
+*	the lexer makes one pass over the line and writes each word back into the line itself
+*	with its quotes and backslashes taken out, so nothing gets copied anywhere else. the
+*	stretches of ordinary characters between the interesting ones are found 16 or 32 bytes
+*	at a time with SSE2 or AVX2 when the CPU has them, see lexScan below
+***************************************************************************************/
+
+#include "smallsh.h"
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LEXER_HAVE_X86 1
+#endif
+
+#define LEX_MARKER_BYTES "\x01\x02\x03\x04\x05" //EXPANSION_MARK, EXPANSION_END and the GLOB_ markers, they can't show up in a line since they'd be taken for expansions or globs
+
+
+//the bytes that end a run of ordinary characters in each lexer mode. outside of quotes that's whitespace, newlines, quotes, backslashes,
+//'$', the glob characters and the operator characters, inside double quotes only the closing quote, backslashes and '$' matter, and inside single quotes just the
+//closing quote. the null terminator and the two expansion marker bytes end a run in every mode
+static const char* lexSpecials[LEX_MODE_COUNT] = {
+	" \t\n'\"\\$|&;<>*?[" LEX_MARKER_BYTES,
+	"\"\\$" LEX_MARKER_BYTES,
+	"'" LEX_MARKER_BYTES,
+};
+
+static unsigned char lexClass[256]; //bit (1 << mode) is set for every byte that's special in that mode, for the scalar scanner
+static const char* lexImplementation = NULL; //the name of the scanner lexScan points at, NULL until lexerSelect() has run
+static size_t (*lexScan)(const char* p, int mode); //how many ordinary bytes there are at p before the first special one for the mode
+
+
+//the plain byte at a time scanner, this is what machines without SSE2 get
+static size_t lexScanScalar(const char* p, int mode) {
+	const unsigned char* start = (const unsigned char*)p;
+	const unsigned char* scan = start;
+	unsigned char bit = 1 << mode;
+	while (!(lexClass[*scan] & bit)) {
+		scan++;
+	}
+	return scan - start;
+}
+
+
+#ifdef LEXER_HAVE_X86
+
+//most words are only a few bytes long, and for those setting up a vector compare costs more than it saves, so the SIMD scanners look
+//at this many bytes one at a time before they start on whole blocks
+#define LEX_SCALAR_PREFIX 16
+
+/*	the SIMD scanners never know how long the line is, they just stop at the null terminator like the scalar one. every load is aligned,
+which means it can't cross into the next page, so reading the rest of the block past the terminator (or the part of the first block
+before p) can never fault. the bits for bytes before p get shifted off the first mask */
+
+//SSE2 has no byte shuffle, so each block is compared against every special byte of the mode and the results are or'd together
+static __m128i lexSSE2Specials[LEX_MODE_COUNT][32];
+static int lexSSE2SpecialCount[LEX_MODE_COUNT];
+
+static inline unsigned lexClassifySSE2(const char* block, int mode) {
+	__m128i bytes = _mm_load_si128((const __m128i*)block);
+	__m128i hits = _mm_cmpeq_epi8(bytes, _mm_setzero_si128());
+	for (int i = 0; i < lexSSE2SpecialCount[mode]; i++) {
+		hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, lexSSE2Specials[mode][i]));
+	}
+	return _mm_movemask_epi8(hits);
+}
+
+static size_t lexScanSSE2(const char* p, int mode) {
+	unsigned char bit = 1 << mode;
+	for (int i = 0; i < LEX_SCALAR_PREFIX; i++) {
+		if (lexClass[(unsigned char)p[i]] & bit) {
+			return i;
+		}
+	}
+	p += LEX_SCALAR_PREFIX;
+	const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)15);
+	unsigned mask = lexClassifySSE2(block, mode) >> (p - block);
+	if (mask != 0) {
+		return LEX_SCALAR_PREFIX + __builtin_ctz(mask);
+	}
+	for (block += 16; ; block += 16) {
+		mask = lexClassifySSE2(block, mode);
+		if (mask != 0) {
+			return LEX_SCALAR_PREFIX + (block - p) + __builtin_ctz(mask);
+		}
+	}
+}
+
+
+//AVX2 can do a 16 entry table lookup on every byte at once, so instead of one compare per special byte each byte's low and high nibble
+//get looked up in two tables and a byte is special if the two results share a bit. every high nibble that has a special byte gets its
+//own bit, and that bit is set in the low nibble table for each of that row's special bytes, so the lookup is exact
+static unsigned char lexNibbleLow[LEX_MODE_COUNT][16];
+static unsigned char lexNibbleHigh[LEX_MODE_COUNT][16];
+
+__attribute__((target("avx2")))
+static inline unsigned lexClassifyAVX2(const char* block, __m256i lowTable, __m256i highTable) {
+	__m256i bytes = _mm256_load_si256((const __m256i*)block);
+	__m256i nibbleMask = _mm256_set1_epi8(0x0f);
+	__m256i low = _mm256_shuffle_epi8(lowTable, _mm256_and_si256(bytes, nibbleMask));
+	__m256i high = _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibbleMask));
+	__m256i ordinary = _mm256_cmpeq_epi8(_mm256_and_si256(low, high), _mm256_setzero_si256());
+	return ~(unsigned)_mm256_movemask_epi8(ordinary);
+}
+
+__attribute__((target("avx2")))
+static size_t lexScanAVX2(const char* p, int mode) {
+	unsigned char bit = 1 << mode;
+	for (int i = 0; i < LEX_SCALAR_PREFIX; i++) {
+		if (lexClass[(unsigned char)p[i]] & bit) {
+			return i;
+		}
+	}
+	p += LEX_SCALAR_PREFIX;
+	__m256i lowTable = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)lexNibbleLow[mode]));
+	__m256i highTable = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)lexNibbleHigh[mode]));
+	const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)31);
+	unsigned mask = lexClassifyAVX2(block, lowTable, highTable) >> (p - block);
+	if (mask != 0) {
+		return LEX_SCALAR_PREFIX + __builtin_ctz(mask);
+	}
+	for (block += 32; ; block += 32) {
+		mask = lexClassifyAVX2(block, lowTable, highTable);
+		if (mask != 0) {
+			return LEX_SCALAR_PREFIX + (block - p) + __builtin_ctz(mask);
+		}
+	}
+}
+
+#endif
+
+
+/*	FUNCTION: lexerSelect
+builds the classification tables and picks a scanner. name can be "avx2", "sse2" or "scalar" to ask for one (the benchmark uses this
+to compare them), or NULL for the fastest one this CPU has. returns -1 if the one asked for isn't available here
+*/
+int lexerSelect(const char* name) {
+
+	memset(lexClass, 0, sizeof(lexClass));
+	for (int mode = 0; mode < LEX_MODE_COUNT; mode++) {
+		//the null terminator isn't in the strings, so it gets added by hand
+		lexClass[0] |= 1 << mode;
+		for (const char* c = lexSpecials[mode]; *c != '\0'; c++) {
+			lexClass[(unsigned char)*c] |= 1 << mode;
+		}
+	}
+
+#ifdef LEXER_HAVE_X86
+	for (int mode = 0; mode < LEX_MODE_COUNT; mode++) {
+		lexSSE2SpecialCount[mode] = 0;
+		memset(lexNibbleLow[mode], 0, 16);
+		memset(lexNibbleHigh[mode], 0, 16);
+		int rowBits[16] = {0};
+		int nextBit = 0;
+		for (int byte = 0; byte < 256; byte++) {
+			if (!(lexClass[byte] & (1 << mode))) {
+				continue;
+			}
+			if (byte != 0) {
+				lexSSE2Specials[mode][lexSSE2SpecialCount[mode]++] = _mm_set1_epi8((char)byte);
+			}
+			if (rowBits[byte >> 4] == 0) {
+				rowBits[byte >> 4] = 1 << nextBit++;
+			}
+			lexNibbleHigh[mode][byte >> 4] |= rowBits[byte >> 4];
+			lexNibbleLow[mode][byte & 0x0f] |= rowBits[byte >> 4];
+		}
+	}
+
+	__builtin_cpu_init();
+	int haveAVX2 = __builtin_cpu_supports("avx2");
+	if (name == NULL) {
+		name = haveAVX2 ? "avx2" : "sse2";
+	}
+	if (strcmp(name, "avx2") == 0 && haveAVX2) {
+		lexScan = lexScanAVX2;
+		lexImplementation = "avx2";
+		return 0;
+	}
+	if (strcmp(name, "sse2") == 0) {
+		lexScan = lexScanSSE2;
+		lexImplementation = "sse2";
+		return 0;
+	}
+#endif
+
+	if (name == NULL || strcmp(name, "scalar") == 0) {
+		lexScan = lexScanScalar;
+		lexImplementation = "scalar";
+		return 0;
+	}
+	return -1;
+}
+
+
+//the name of the scanner in use, for the benchmark
+const char* lexerImplementation() {
+	if (lexImplementation == NULL) {
+		lexerSelect(NULL);
+	}
+	return lexImplementation;
+}
+
+
+//starts lexing a line, the line gets written over as words are taken out of it
+void lexerInit(struct smallshLexer* lexer, char* line) {
+	if (lexScan == NULL) {
+		lexerSelect(NULL);
+	}
+	lexer->in = line;
+	lexer->out = line;
+	lexer->held = '\0';
+	lexer->nameOpen = 0;
+}
+
+
+//the byte the lexer is looking at, which might be one that got written over by the end of the last word
+static inline char lexPeek(struct smallshLexer* lexer) {
+	return (lexer->held != '\0') ? lexer->held : *lexer->in;
+}
+
+//moves past the byte lexPeek() returned
+static inline void lexAdvance(struct smallshLexer* lexer) {
+	lexer->held = '\0';
+	lexer->in++;
+}
+
+static inline int isNameChar(char c) {
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+
+/*	FUNCTION: lexEmit
+writes count bytes of a word to the output position. the bytes are usually already sitting exactly there, so it's only a memmove() once
+quotes or backslashes have made the output fall behind. a '$NAME' marker has no end of its own, so if the next byte would run into the
+name it gets an EXPANSION_END first. there's always room for it since whatever separated the name from that byte in the line (a quote,
+a backslash or a '}') didn't get written
+*/
+static inline void lexEmit(struct smallshLexer* lexer, const char* bytes, size_t count) {
+	if (count == 0) {
+		return;
+	}
+	if (lexer->nameOpen) {
+		if (isNameChar(bytes[0])) {
+			*lexer->out++ = EXPANSION_END;
+		}
+		lexer->nameOpen = 0;
+	}
+	if (lexer->out != bytes) {
+		memmove(lexer->out, bytes, count);
+	}
+	lexer->out += count;
+}
+
+
+/*	FUNCTION: lexSubstitutionEnd
+finds the ')' that closes a '$(' when p is right after it. quotes, backslashes and nested '$(...)'s are stepped over so a ')' in any of
+them doesn't count, and a '(' in the text needs its own ')'. nothing inside gets lexed yet, that happens when the substitution runs.
+returns NULL if the line ends first
+*/
+static char* lexSubstitutionEnd(char* p) {
+
+	int depth = 0;
+	for (; *p != '\0'; p++) {
+		if (*p == '\\') {
+			if (p[1] == '\0') {
+				return NULL;
+			}
+			p++;
+		}
+		else if (*p == '\'') {
+			p = strchr(p + 1, '\'');
+			if (p == NULL) {
+				return NULL;
+			}
+		}
+		else if (*p == '"') {
+			for (p++; *p != '"'; p++) {
+				if (*p == '\0') {
+					return NULL;
+				}
+				if (*p == '\\' && p[1] != '\0') {
+					p++;
+				}
+				else if (*p == '$' && p[1] == '(') {
+					p = lexSubstitutionEnd(p + 2);
+					if (p == NULL) {
+						return NULL;
+					}
+				}
+			}
+		}
+		else if (*p == '$' && p[1] == '(') {
+			p = lexSubstitutionEnd(p + 2);
+			if (p == NULL) {
+				return NULL;
+			}
+		}
+		else if (*p == '(') {
+			depth++;
+		}
+		else if (*p == ')') {
+			if (depth == 0) {
+				return p;
+			}
+			depth--;
+		}
+	}
+	return NULL;
+}
+
+
+/*	FUNCTION: lexDollar
+handles a '$' in a word (outside of quotes or in double quotes if quoted is true), lexer->in is on the '$'. '$$', '$?', '$!', '$NAME' 
+and '${NAME}' turn into an EXPANSION_MARK followed by the name, which expandWord() fills in when the command runs. that way '$?' is the 
+status of whatever ran right before it and not of the line before this one. '$(...)' becomes an EXPANSION_MARK, SUBSTITUTION_SPLIT or 
+SUBSTITUTION_QUOTED depending on whether its output gets split into words, the command text untouched and an EXPANSION_END, which 
+is exactly as long as what it replaces. a '$' that isn't followed by any of those is just a '$'. returns 1 if it wrote an expansion, 0 
+if it was a plain '$' and -1 if it was a bad '${' or '$('
+*/
+static int lexDollar(struct smallshLexer* lexer, int quoted) {
+
+	char* dollar = lexer->in;
+	char next = dollar[1];
+
+	if (next == '(') {
+		char* text = dollar + 2;
+		char* end = lexSubstitutionEnd(text);
+		if (end == NULL) {
+			fprintf(stderr, "smallsh: syntax error, unterminated '$('\n");
+			return -1;
+		}
+		//the text is copied through as it is, so it can't have the marker bytes in it that would end it early
+		for (char* check = text; check < end; check++) {
+			if (strchr(LEX_MARKER_BYTES, *check) != NULL) {
+				fprintf(stderr, "smallsh: syntax error, control character in command line\n");
+				return -1;
+			}
+		}
+		lexer->nameOpen = 0;
+		lexer->out[0] = EXPANSION_MARK;
+		lexer->out[1] = quoted ? SUBSTITUTION_QUOTED : SUBSTITUTION_SPLIT;
+		memmove(lexer->out + 2, text, end - text);
+		lexer->out += 2 + (end - text);
+		*lexer->out++ = EXPANSION_END;
+		lexer->in = end + 1;
+		return 1;
+	}
+
+	if (next == '$' || next == '?' || next == '!') {
+		lexer->nameOpen = 0;
+		lexer->out[0] = EXPANSION_MARK;
+		lexer->out[1] = next;
+		lexer->out += 2;
+		lexer->in += 2;
+		return 1;
+	}
+
+	if (next == '{') {
+		char* name = dollar + 2;
+		char* end = name;
+		while (isNameChar(*end)) {
+			end++;
+		}
+		if (*end != '}' || end == name || isdigit((unsigned char)*name)) {
+			fprintf(stderr, "smallsh: syntax error, bad substitution\n");
+			return -1;
+		}
+		lexer->nameOpen = 0;
+		*lexer->out++ = EXPANSION_MARK;
+		memmove(lexer->out, name, end - name);
+		lexer->out += end - name;
+		lexer->nameOpen = 1;
+		lexer->in = end + 1;
+		return 1;
+	}
+
+	if (isalpha((unsigned char)next) || next == '_') {
+		char* end = dollar + 1;
+		while (isNameChar(*end)) {
+			end++;
+		}
+		lexer->nameOpen = 0;
+		//'$NAME' is the same length as its marker, so this is the one place output can catch all the way up to input
+		*lexer->out++ = EXPANSION_MARK;
+		memmove(lexer->out, dollar + 1, end - (dollar + 1));
+		lexer->out += end - (dollar + 1);
+		lexer->nameOpen = 1;
+		lexer->in = end;
+		return 1;
+	}
+
+	lexEmit(lexer, dollar, 1);
+	lexer->in++;
+	return 0;
+}
+
+
+//true if the '[' at p starts a bracket expression, which takes a ']' closing it before the word ends or anything in it is quoted. a ']'
+//right after the '[' (or the '[!') is one of the characters, like in '[]a]'
+static int lexBracketCloses(const char* p) {
+	p++;
+	if (*p == '!' || *p == '^') {
+		p++;
+	}
+	if (*p == ']') {
+		p++;
+	}
+	for (; *p != ']'; p++) {
+		if ((lexClass[(unsigned char)*p] & (1 << LEX_UNQUOTED)) && *p != '*' && *p != '?' && *p != '[') {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+/*	FUNCTION: lexOperator
+lexes a '|', '||', '&', '&&', ';', newline or redirection operator starting at the current byte into token. fd is the descriptor number that was written right in
+front of a redirection or -1. returns 1, or -1 for an operator we don't support
+*/
+static int lexOperator(struct smallshLexer* lexer, struct smallshToken* token, int fd) {
+
+	char c = lexPeek(lexer);
+	lexAdvance(lexer);
+	token->text = NULL;
+	token->flags = 0;
+	token->fd = fd;
+
+	if (c == '|' || c == '&') {
+		if (lexer->in[0] == c) {
+			lexer->in++;
+			token->type = (c == '|') ? TOKEN_OR : TOKEN_AND;
+		}
+		else {
+			token->type = (c == '|') ? TOKEN_PIPE : TOKEN_AMPERSAND;
+		}
+		return 1;
+	}
+	//a newline only shows up when a construct or a '&&' went on past the end of its first line and the lines got joined, and it
+	//separates commands the same way ';' does except that it can also go right after a '&&' or '||'
+	if (c == ';') {
+		token->type = TOKEN_SEPARATOR;
+		return 1;
+	}
+	if (c == '\n') {
+		token->type = TOKEN_NEWLINE;
+		return 1;
+	}
+
+	token->type = TOKEN_REDIRECT;
+	if (c == '<') {
+		if (lexer->in[0] == '<' && lexer->in[1] == '<') {
+			token->redirect = REDIRECT_STRING;
+			lexer->in += 2;
+		}
+		else if (lexer->in[0] == '<') {
+			fprintf(stderr, "smallsh: syntax error, here-documents aren't supported, use '<<< text'\n");
+			return -1;
+		}
+		else if (lexer->in[0] == '&') {
+			token->redirect = REDIRECT_DUP;
+			lexer->in++;
+		}
+		else {
+			token->redirect = REDIRECT_INPUT;
+		}
+		if (token->fd == -1) {
+			token->fd = 0;
+		}
+	}
+	else {
+		if (lexer->in[0] == '>') {
+			token->redirect = REDIRECT_APPEND;
+			lexer->in++;
+		}
+		else if (lexer->in[0] == '&') {
+			token->redirect = REDIRECT_DUP;
+			lexer->in++;
+		}
+		else {
+			token->redirect = REDIRECT_OUTPUT;
+		}
+		if (token->fd == -1) {
+			token->fd = 1;
+		}
+	}
+	return 1;
+}
+
+
+/*	FUNCTION: lexNext
+finds the next token on the line. words have their quotes and backslashes taken out and are null terminated in place, with the flags
+saying whether any of it was quoted, whether it has expansions to fill in and whether it has globs. a '#' at the start of a word makes the rest of the line a
+comment, up to the next newline if lines have been joined. returns 1 for a token, 0 at the end of the line and -1 (after printing why) if the line can't be lexed
+*/
+int lexNext(struct smallshLexer* lexer, struct smallshToken* token) {
+
+	char c = lexPeek(lexer);
+	while (c == ' ' || c == '\t') {
+		lexAdvance(lexer);
+		c = lexPeek(lexer);
+	}
+
+	if (c == '#') {
+		char* newline = strchr(lexer->in, '\n');
+		if (newline == NULL) {
+			return 0;
+		}
+		lexer->in = newline;
+		c = '\n';
+	}
+	if (c == '\0') {
+		return 0;
+	}
+	if (c == '|' || c == '&' || c == ';' || c == '\n' || c == '<' || c == '>') {
+		return lexOperator(lexer, token, -1);
+	}
+
+	//it's a word
+	lexer->out = lexer->in;
+	lexer->nameOpen = 0;
+	token->type = TOKEN_WORD;
+	token->text = lexer->out;
+	token->flags = 0;
+	token->fd = -1;
+
+	while (1) {
+		size_t run = lexScan(lexer->in, LEX_UNQUOTED);
+		lexEmit(lexer, lexer->in, run);
+		lexer->in += run;
+		c = *lexer->in;
+
+		if (c == '\0' || c == ' ' || c == '\t' || c == '\n' || c == '|' || c == '&' || c == ';') {
+			break;
+		}
+		else if (c == '<' || c == '>') {
+			//a word of nothing but digits right up against a redirection is the descriptor it redirects, like the 2 in '2>&1'
+			if (token->flags == 0 && lexer->out > token->text && lexer->out - token->text < 10) {
+				char* digit = token->text;
+				while (digit < lexer->out && isdigit((unsigned char)*digit)) {
+					digit++;
+				}
+				if (digit == lexer->out) {
+					return lexOperator(lexer, token, atoi(token->text));
+				}
+			}
+			break;
+		}
+		else if (c == '*' || c == '?' || (c == '[' && lexBracketCloses(lexer->in))) {
+			//an unquoted glob character becomes a marker so globWord() can tell it apart from a quoted one, which stays a plain character
+			token->flags |= TOKEN_GLOBS;
+			*lexer->in = (c == '*') ? GLOB_STAR : (c == '?') ? GLOB_ONE : GLOB_BRACKET;
+			lexEmit(lexer, lexer->in, 1);
+			lexer->in++;
+		}
+		else if (c == '[') {
+			lexEmit(lexer, lexer->in, 1);
+			lexer->in++;
+		}
+		else if (c == '\'') {
+			token->flags |= TOKEN_QUOTED;
+			lexer->in++;
+			run = lexScan(lexer->in, LEX_SINGLE_QUOTED);
+			lexEmit(lexer, lexer->in, run);
+			lexer->in += run;
+			if (*lexer->in != '\'') {
+				fprintf(stderr, (*lexer->in == '\0') ? "smallsh: syntax error, unterminated \"'\"\n" : "smallsh: syntax error, control character in command line\n");
+				return -1;
+			}
+			lexer->in++;
+		}
+		else if (c == '"') {
+			token->flags |= TOKEN_QUOTED;
+			lexer->in++;
+			while (1) {
+				run = lexScan(lexer->in, LEX_DOUBLE_QUOTED);
+				lexEmit(lexer, lexer->in, run);
+				lexer->in += run;
+				c = *lexer->in;
+				if (c == '"') {
+					lexer->in++;
+					break;
+				}
+				else if (c == '\\') {
+					//inside double quotes a backslash only escapes the characters that would mean something there
+					if (lexer->in[1] == '"' || lexer->in[1] == '\\' || lexer->in[1] == '$' || lexer->in[1] == '`') {
+						lexEmit(lexer, lexer->in + 1, 1);
+						lexer->in += 2;
+					}
+					else {
+						lexEmit(lexer, lexer->in, 1);
+						lexer->in++;
+					}
+				}
+				else if (c == '$') {
+					int result = lexDollar(lexer, 1);
+					if (result == -1) {
+						return -1;
+					}
+					token->flags |= (result == 1) ? TOKEN_EXPANDS : 0;
+				}
+				else {
+					fprintf(stderr, (c == '\0') ? "smallsh: syntax error, unterminated '\"'\n" : "smallsh: syntax error, control character in command line\n");
+					return -1;
+				}
+			}
+		}
+		else if (c == '\\') {
+			token->flags |= TOKEN_QUOTED;
+			//a backslash at the very end of the line has nothing to escape, so it just goes away, and one in front of a newline joins
+			//the two lines like it does in sh
+			if (lexer->in[1] == '\0') {
+				lexer->in++;
+			}
+			else if (lexer->in[1] == '\n') {
+				lexer->in += 2;
+			}
+			else {
+				lexEmit(lexer, lexer->in + 1, 1);
+				lexer->in += 2;
+			}
+		}
+		else if (c == '$') {
+			int result = lexDollar(lexer, 0);
+			if (result == -1) {
+				return -1;
+			}
+			token->flags |= (result == 1) ? TOKEN_EXPANDS : 0;
+		}
+		else {
+			fprintf(stderr, "smallsh: syntax error, control character in command line\n");
+			return -1;
+		}
+	}
+
+	//end the word. whitespace after it can just be stepped over, but if the output caught all the way up to the input the terminator
+	//lands on the operator or newline that ended the word, which still has to be lexed, so it gets remembered
+	if (c == ' ' || c == '\t') {
+		lexer->in++;
+	}
+	else if (c != '\0' && lexer->out == lexer->in) {
+		lexer->held = c;
+	}
+	*lexer->out = '\0';
+	return 1;
+}
+
+
+//one filled in expansion marker of a word, see expandWord()
+struct expansionValue {
+	const char* text;
+	size_t length;
+	const char* next; //where the word picks up after the marker
+	int split; //a bool that's true for an unquoted '$(...)', whose output can be split into more than one word
+	char* owned; //the malloc'd output of a '$(...)', freed once it's been copied. NULL otherwise
+	char number[16]; //room for '$?' and '$!' to be formatted into
+};
+
+
+/*	FUNCTION: expandWord
+fills in the expansion markers in a word that the lexer flagged with TOKEN_EXPANDS: $$ is the shell's PID, $? the exit code of the last
+command (128 plus the signal if it was killed), $! the PID of the last background job, '$(...)' whatever its commands printed and anything
+else is a shell variable (like a for loop's) or else looked up in the environment, with unset variables expanding to nothing. every value
+is worked out once first, which also adds up the new length so the result is allocated once, and then they're copied in. a variable is
+never split, so '$HOME' is always one argument no matter what's in it. when fieldCount isn't NULL the output of an unquoted '$(...)' gets
+split at spaces, tabs and newlines: the result is then fieldCount words one after another, each null terminated, and a word that was only
+a '$(...)' that printed nothing is no words at all. a redirect target passes NULL and always gets one word
+*/
+char* expandWord(const char* word, struct smallshContext* context, struct smallshArena* arena, int* fieldCount) {
+
+	int markCount = 0;
+	for (const char* mark = strchr(word, EXPANSION_MARK); mark != NULL; mark = strchr(mark + 1, EXPANSION_MARK)) {
+		markCount++;
+	}
+	struct expansionValue* values = arenaAlloc(arena, sizeof(struct expansionValue) * markCount);
+
+	size_t length = 0;
+	const char* in = word;
+	for (int i = 0; i < markCount; i++) {
+		struct expansionValue* value = &values[i];
+		const char* mark = strchr(in, EXPANSION_MARK);
+		const char* name = mark + 1;
+		length += mark - in;
+		value->split = 0;
+		value->owned = NULL;
+
+		if (*name == '$') {
+			value->text = pidString;
+			value->length = pidStringLen;
+			value->next = name + 1;
+			length += value->length;
+			in = value->next;
+			continue;
+		}
+		else if (*name == '?' || *name == '!') {
+			if (*name == '?') {
+				snprintf(value->number, sizeof(value->number), "%d", WIFEXITED(context->childStatus) ? WEXITSTATUS(context->childStatus) : 128 + WTERMSIG(context->childStatus));
+			}
+			else if (context->lastBackgroundPid > 0) {
+				snprintf(value->number, sizeof(value->number), "%d", context->lastBackgroundPid);
+			}
+			else {
+				value->number[0] = '\0';
+			}
+			value->text = value->number;
+			value->next = name + 1;
+		}
+		else if (*name == SUBSTITUTION_SPLIT || *name == SUBSTITUTION_QUOTED) {
+			const char* end = strchr(name + 1, EXPANSION_END);
+			value->owned = runSubstitution(name + 1, end - (name + 1), context, &value->length);
+			value->text = (value->owned != NULL) ? value->owned : "";
+			value->split = (*name == SUBSTITUTION_SPLIT);
+			value->next = end + 1;
+			length += value->length;
+			in = value->next;
+			continue;
+		}
+		else {
+			const char* end = name;
+			while (isNameChar(*end)) {
+				end++;
+			}
+			char nameCopy[end - name + 1];
+			memcpy(nameCopy, name, end - name);
+			nameCopy[end - name] = '\0';
+			struct smallshVariable* variable = findVariable(context, nameCopy);
+			value->text = (variable != NULL) ? variable->value : getenv(nameCopy);
+			if (value->text == NULL) {
+				value->text = "";
+			}
+			value->next = (*end == EXPANSION_END) ? end + 1 : end;
+		}
+		value->length = strlen(value->text);
+		length += value->length;
+		in = value->next;
+	}
+	length += strlen(in);
+
+	//splitting only ever turns a space into a null terminator, so the length with nothing split is always enough
+	char* result = arenaAlloc(arena, length + 1);
+	char* out = result;
+	int fields = 0;
+	int started = 0; //a bool that's true once the current word has anything in it, even an empty variable, so it counts as a word
+	in = word;
+	for (int i = 0; i <= markCount; i++) {
+		const char* mark = (i < markCount) ? strchr(in, EXPANSION_MARK) : in + strlen(in);
+		memcpy(out, in, mark - in);
+		out += mark - in;
+		started |= (mark > in);
+		if (i == markCount) {
+			break;
+		}
+
+		struct expansionValue* value = &values[i];
+		if (value->split && fieldCount != NULL) {
+			for (size_t j = 0; j < value->length; j++) {
+				char c = value->text[j];
+				if (c == ' ' || c == '\t' || c == '\n') {
+					if (started) {
+						*out++ = '\0';
+						fields++;
+						started = 0;
+					}
+				}
+				else {
+					*out++ = c;
+					started = 1;
+				}
+			}
+		}
+		else {
+			memcpy(out, value->text, value->length);
+			out += value->length;
+			started = 1;
+		}
+		free(value->owned);
+		in = value->next;
+	}
+	*out = '\0';
+
+	if (fieldCount != NULL) {
+		*fieldCount = fields + started;
+	}
+	return result;
+}
+
+
+//makes sure an argument array being built has room for needed more arguments and the terminating NULL, doubling it in the arena if not
+static char** expandReserve(char** expanded, int count, int needed, int* capacity, struct smallshArena* arena) {
+	if (count + needed + 1 <= *capacity) {
+		return expanded;
+	}
+	*capacity = (count + needed + 1) * 2;
+	char** grown = arenaAlloc(arena, sizeof(char*) * *capacity);
+	memcpy(grown, expanded, sizeof(char*) * count);
+	return grown;
+}
+
+
+/*	FUNCTION: expandCommand
+fills in the expansions of every stage of a pipeline that has any, right before it runs, and then matches the words with globs in them
+against file names. the words as they were lexed stay in the stage's words array and a freshly expanded arguments array is built from
+them each time, so the same command struct can be run more than once and see new values (and new files) every time. a '$(...)' or a
+glob can turn one word into any number of arguments, so the array grows as needed. only globs written in the line itself get matched,
+not ones that come out of a variable or a '$(...)'
+*/
+void expandCommand(struct smallshCommand* input, struct smallshContext* context) {
+
+	for (struct smallshCommand* stage = input; stage != NULL; stage = stage->nextStage) {
+		if (!stage->needsExpansion) {
+			continue;
+		}
+
+		//there's always room left for one argument per word still to come, so a word that stays one argument doesn't have to check
+		int capacity = stage->wordCount + 1;
+		int count = 0;
+		char** expanded = arenaAlloc(context->arena, sizeof(char*) * capacity);
+		for (int i = 0; i < stage->wordCount; i++) {
+			char* word = stage->words[i];
+			int expands = (strchr(word, EXPANSION_MARK) != NULL);
+			if (!expands && !globHasMarks(word)) {
+				expanded[count++] = word;
+				continue;
+			}
+			int fieldCount = 1;
+			char* field = expands ? expandWord(word, context, context->arena, &fieldCount) : word;
+			for (int j = 0; j < fieldCount; j++) {
+				int globs = globHasMarks(field);
+				int matchCount = 0;
+				char** matches = (globs && !noGlob) ? globWord(field, context->arena, &matchCount) : NULL;
+				int later = (fieldCount - j - 1) + (stage->wordCount - i - 1);
+				expanded = expandReserve(expanded, count, (matchCount > 0 ? matchCount : 1) + later, &capacity, context->arena);
+				if (matchCount > 0) {
+					memcpy(expanded + count, matches, sizeof(char*) * matchCount);
+					count += matchCount;
+				}
+				else if (globs) {
+					//nothing matched, so the word stays as it was written. the lexed word gets run again next time, so it's copied first
+					char* literal = (field == word) ? arenaStrndup(context->arena, word, strlen(word)) : field;
+					globLiteral(literal);
+					expanded[count++] = literal;
+				}
+				else {
+					expanded[count++] = field;
+				}
+				field += strlen(field) + 1;
+			}
+		}
+		expanded[count] = NULL;
+		stage->arguments = expanded;
+		stage->argCount = count;
+		stage->argCapacity = capacity;
+		stage->command = (count > 0) ? expanded[0] : NULL;
+
+		for (struct smallshRedirect* redirect = stage->redirects; redirect != NULL; redirect = redirect->next) {
+			if (redirect->word != NULL) {
+				redirect->target = expandWord(redirect->word, context, context->arena, NULL);
+			}
+		}
+	}
+}
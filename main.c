@@ -0,0 +1,90 @@
+/***************************************************************************************
+* Program: SmallShell 
+* Author: Lucas Moyle
+* Description: the shell's entry point. it sets up the signal handlers, works out where the 
+*	command lines come from (stdin, a script file or a -c string) and hands off to the main 
+*	loop in smallsh.c
+***************************************************************************************/
+
+#include "smallsh.h"
+
+
+/*	FUNCTION: handler_SIGTSTOP
+this is our signal handler for SIGTSTP, it basically just toggles a global variable (I have no idea how to pass another value here) 
+that when true will run all commands using callExecForeground(). an interactive shell ignores SIGTSTP instead once job control takes 
+over (^Z stops the foreground job then, and 'set -o fgonly' is the toggle), so this is for scripts and piped input
+*/
+void handler_SIGTSTP(int signo) {
+
+	if (foregroundOnlyMode == 0) {
+		char* foregroundMessage = "\nEntering foreground-only mode (& is now ignored)\n:";
+		write(1, foregroundMessage, 51);
+		fflush(stdout);
+		foregroundOnlyMode = 1;
+	}
+	else {
+		char* foregroundMessage = "\nExiting foreground-only mode\n:";
+		write(1, foregroundMessage, 31);
+		fflush(stdout);
+		foregroundOnlyMode = 0;
+	}
+}
+
+
+
+
+int main(int argc, char** argv) {
+
+	//set up out signal handler to ignore sigint in the main shell
+	struct sigaction SIGINT_action = {0};
+	SIGINT_action.sa_handler = SIG_IGN;
+	sigfillset(&SIGINT_action.sa_mask);
+	SIGINT_action.sa_flags = SA_RESTART; //we need to set SA_RESTART here so reading input doesn't get screwed up
+	sigaction(SIGINT, &SIGINT_action, NULL);
+
+	struct sigaction SIGTSTP_action = {0};
+	SIGTSTP_action.sa_handler = handler_SIGTSTP;
+	sigfillset(&SIGTSTP_action.sa_mask);
+	SIGTSTP_action.sa_flags = SA_RESTART; //we need to set SA_RESTART again
+	sigaction(SIGTSTP, &SIGTSTP_action, NULL);
+
+	//our PID never changes, so turn it into the string that '$$' expands to just once
+	pidStringLen = snprintf(pidString, sizeof(pidString), "%d", getpid());
+
+	//pick our launch path, anything other than "fork" gets the posix_spawnp() one
+	char* launcher = getenv(LAUNCHER_ENV_VAR);
+	if (launcher != NULL && strcmp(launcher, "fork") == 0) {
+		launcherMode = LAUNCH_FORK;
+	}
+
+	//the lexer picks the fastest scanner this CPU has unless one is asked for by name
+	if (lexerSelect(getenv(LEXER_ENV_VAR)) == -1) {
+		fprintf(stderr, "smallsh: %s=%s isn't available here, using %s\n", LEXER_ENV_VAR, getenv(LEXER_ENV_VAR), (lexerSelect(NULL), lexerImplementation()));
+	}
+
+	//tracing is set up before anything else runs so the trace covers the whole session
+	if (getenv(TRACE_ENV_VAR) != NULL && getenv(TRACE_ENV_VAR)[0] != '\0') {
+		traceStart(getenv(TRACE_ENV_VAR));
+	}
+
+	//figure out where our commands come from: 'smallsh -c "commands"', 'smallsh script', or stdin when there are no arguments
+	struct smallshInput input;
+	if (argc > 2 && strcmp(argv[1], "-c") == 0) {
+		inputFromString(&input, argv[2]);
+	}
+	else if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+		fprintf(stderr, "smallsh: -c: option requires an argument\n");
+		return 2;
+	}
+	else if (argc > 1) {
+		if (inputFromScript(&input, argv[1]) == -1) {
+			fprintf(stderr, "smallsh: %s: %s\n", argv[1], strerror(errno));
+			return 127;
+		}
+	}
+	else {
+		inputFromFD(&input, STDIN_FILENO, 1);
+	}
+
+	return smallshMainLoop(SIGINT_action, &input);
+}
@@ -11,540 +11,3814 @@
 *	a bit off sometimes, a few of the arrays should probably be dynamic, I'm not entirely
 *	sure if I handled input/output redirection 'correctly' (but it works for the test script), 
 *	and I'm not entirely sure my 'exit' command does everything it is supposed to.
-*	The signal handlers were probably the hardest thing to get working and I still can't figure 
-*	out a way to get a exit status to print when immediately when ^C SIGINT cancels a foreground 
-*	process...
+*	The signal handlers were probably the hardest thing to get working. A foreground command 
+*	that gets killed by a signal (like ^C) is reported the moment it's reaped now, and with job 
+*	control ^Z stops it so 'fg' and 'bg' can pick it back up, see jobcontrol.c.
+*
+*	Everything but main(), the builtins that stand in for programs (builtins.c), the lexer 
+*	(lexer.c), command substitution (substitute.c), globbing (glob.c), time limits (timeout.c), job control (jobcontrol.c) and tracing (trace.c) is in here so the benchmark harness in bench/ can link against it, see smallsh.h 
+*	for the declarations and main.c for the entry point.
 ***************************************************************************************/
 
-#include <sys/wait.h> 
-#include <sys/types.h>
-#include <stdio.h>    
-#include <stdlib.h>   
-#include <unistd.h>   
-#include <string.h>
-#include <fcntl.h>
-#include <signal.h>
-#include <errno.h>
-
-
-#define MAX_ARGUMENTS 512 //this the size of the array that holds each argument string. it could be a dynamic array but nawwwwww im lazy and the assigment instructions say max 512
-#define DELIMITERS " \n" //for use with strtok_r
-#define PID_VAR_EXPANSION "$$" //if we wanted to replace something other than '$$' with the PID, we could do that here
-#define MAX_BACKGROUND_PIDS 200 //this is the size of the array that holds all currently running background PIDs, my understaing is that the os1 machine itself has a limit at 200, so that's what we're rolling with
-
-
-int foregroundOnlyMode = 0; //we have to use a global variable for foreground only mode because its tied to a signal, unfortunately
-
-//this is our command struct that an input line will be parsed in to
-struct smallshCommand {
-	char* fullInput; //the full unparsed input line with $$ expanded into the PID
-	char* command; //the first space separated token
-	char* arguments[MAX_ARGUMENTS]; //the rest of the space separated tokens, note index [0] will be the same as command
-	int argCount; //the number of non-null entries in the arguments array
-	char* inputFile; //the token that immediately follows a '<' in the command line, this will not be placed in the args array
-	char* outputFile; //the token that immediately follows a '>' in the command line, not placed in arg array
-	int ampersand; //a bool that if true tells the program to run the command in the background
-	int exitShell; //a bool that if true exits the shell
-};
+#include "smallsh.h"
+
+
+//helpers that are private to this file but get called above where they're defined
+static struct smallshNode* parseList(struct smallshParser* parser, const char** stopWords);
+static int parsePlacementWord(const char* word, struct smallshPlacement* placement);
+static int parseRedirect(struct smallshToken* token, struct smallshToken* target, struct smallshCommand* stage, struct smallshArena* arena);
+static struct smallshRedirect* addRedirect(struct smallshCommand* stage, int fd, enum redirectType type, char* target, struct smallshArena* arena);
+static void closeRedirects(struct smallshCommand* stage);
+
+
+int foregroundOnlyMode = 0; //a bool that when true runs everything in the foreground, global because SIGTSTP toggles it when there's no job control. 'set -o fgonly' otherwise
+int reportBackgroundUsage = 0; //a bool that when true makes background completion messages include what the job cost, turned on with 'set -o bgusage'
+int keepJobOutput = 0; //a bool that when true sends what background jobs print to memory for 'jobs -o' instead of /dev/null and the terminal, turned on with 'set -o joboutput'
+int noGlob = 0; //a bool that when true leaves '*', '?' and '[...]' in words as they are, turned on with 'set -o noglob'
+struct smallshJobOutputs jobOutputs = { .epollFD = -1 }; //global like the path cache, the job table's epoll loop and every foreground wait drain it
+enum launcherType launcherMode = LAUNCH_SPAWN; //which launch path launchPipeline() uses, posix_spawnp() by default and the old fork() path if asked for
+struct smallshPathCache pathCache = { NULL, 0, 0, NULL, -1, -1 }; //global like the other shell-wide settings, launchPipeline() and the epoll loop both need it
+char pidString[32]; //our PID as a string, it never changes so main() formats it once instead of expandWord() doing it for every '$$'
+int pidStringLen = 0;
+struct smallshPlacementSettings placementSettings = {0}; //set by the 'placement' builtin, everything off until then
+
+
+//the monotonic clock in nanoseconds, for timing things that the shell runs
+long long monotonicNanos() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec * 1000000000LL) + now.tv_nsec;
+}
+
+
+//adds one reaped process's rusage into a usage total
+static void addRusage(struct smallshUsage* total, struct rusage* usage) {
+	timeradd(&total->userTime, &usage->ru_utime, &total->userTime);
+	timeradd(&total->systemTime, &usage->ru_stime, &total->systemTime);
+	if (usage->ru_maxrss > total->maxRSS) {
+		total->maxRSS = usage->ru_maxrss;
+	}
+	total->voluntarySwitches += usage->ru_nvcsw;
+	total->involuntarySwitches += usage->ru_nivcsw;
+}
+
+
+//prints a usage total on one line, for 'status -v' and background completion messages
+static void printUsage(FILE* stream, struct smallshUsage* usage) {
+	fprintf(stream, "wall %.3fs  user %ld.%03lds  sys %ld.%03lds  maxrss %ld KiB  ctxsw %ld voluntary / %ld involuntary\n",
+		usage->wallNanos / 1e9,
+		(long)usage->userTime.tv_sec, (long)usage->userTime.tv_usec / 1000,
+		(long)usage->systemTime.tv_sec, (long)usage->systemTime.tv_usec / 1000,
+		usage->maxRSS, usage->voluntarySwitches, usage->involuntarySwitches);
+}
+
+
+/*	FUNCTION: arenaAlloc
+hands out size bytes (rounded up so everything stays pointer aligned) from the arena. if the current block doesn't have room we start 
+a new one that's at least twice as big as the request, the old block stays around until the next reset since things still point into it
+*/
+void* arenaAlloc(struct smallshArena* arena, size_t size) {
+
+	size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+#ifndef NDEBUG
+	arena->allocCount++;
+#endif
+
+	if (arena->current == NULL || arena->current->size - arena->current->used < size) {
+		size_t blockSize = ARENA_BLOCK_SIZE;
+		while (blockSize < size * 2) {
+			blockSize *= 2;
+		}
+		struct smallshArenaBlock* block = malloc(sizeof(struct smallshArenaBlock) + blockSize);
+		if (block == NULL) {
+			perror("malloc()");
+			exit(1);
+		}
+		block->next = arena->current;
+		block->size = blockSize;
+		block->used = 0;
+		arena->current = block;
+		arena->totalSize += blockSize;
+#ifndef NDEBUG
+		arena->mallocCount++;
+#endif
+	}
+
+	void* memory = arena->current->data + arena->current->used;
+	arena->current->used += size;
+	return memory;
+}
+
+
+//copies len chars of a string into the arena and null terminates it
+char* arenaStrndup(struct smallshArena* arena, const char* string, size_t len) {
+	char* copy = arenaAlloc(arena, len + 1);
+	memcpy(copy, string, len);
+	copy[len] = '\0';
+	return copy;
+}
+
+
+/*	FUNCTION: arenaReset
+throws away everything that was allocated from the arena. if the last line needed more than one block, they all get replaced by a single 
+block big enough to hold all of them, that way the arena settles at the size of the biggest line and stops calling malloc()
+*/
+void arenaReset(struct smallshArena* arena) {
+
+	if (arena->current != NULL && arena->current->next != NULL) {
+		size_t totalSize = arena->totalSize;
+		while (arena->current != NULL) {
+			struct smallshArenaBlock* next = arena->current->next;
+			free(arena->current);
+			arena->current = next;
+		}
+		arena->current = malloc(sizeof(struct smallshArenaBlock) + totalSize);
+		if (arena->current == NULL) {
+			perror("malloc()");
+			exit(1);
+		}
+		arena->current->next = NULL;
+		arena->current->size = totalSize;
+		arena->totalSize = totalSize;
+	}
+	if (arena->current != NULL) {
+		arena->current->used = 0;
+	}
+
+#ifndef NDEBUG
+	//debug builds can report how many allocations each line cost, export SMALLSH_ALLOC_STATS to see them
+	if (arena->allocCount > 0 && getenv(ALLOC_STATS_ENV_VAR) != NULL) {
+		fprintf(stderr, "[alloc] arena allocations: %ld, malloc calls: %ld, arena size: %zu\n", arena->allocCount, arena->mallocCount, arena->totalSize);
+	}
+	arena->allocCount = 0;
+	arena->mallocCount = 0;
+#endif
+}
+
+
+//remembers where the arena is up to
+struct smallshArenaMark arenaMark(struct smallshArena* arena) {
+	struct smallshArenaMark mark = { arena->current, (arena->current != NULL) ? arena->current->used : 0 };
+	return mark;
+}
+
+
+/*	FUNCTION: arenaRelease
+throws away everything allocated since the mark was taken, so a loop's body can be run over and over without the line's arena growing. 
+any blocks that were added since then get free'd, which only happens when a single run of the body needed more than the block had left
+*/
+void arenaRelease(struct smallshArena* arena, struct smallshArenaMark mark) {
+	while (arena->current != mark.block) {
+		struct smallshArenaBlock* next = arena->current->next;
+		arena->totalSize -= arena->current->size;
+		free(arena->current);
+		arena->current = next;
+	}
+	if (arena->current != NULL) {
+		arena->current->used = mark.used;
+	}
+}
+
+
+//allocates an empty command struct, used for the first stage of a line and again for every stage after a '|'
+static struct smallshCommand* newCommandStruct(struct smallshArena* arena) {
+	struct smallshCommand* newCommand = arenaAlloc(arena, sizeof(struct smallshCommand));
+	newCommand->fullInput = NULL;
+	newCommand->command = NULL;
+	newCommand->words = NULL;
+	newCommand->wordCount = 0;
+	newCommand->needsExpansion = 0;
+	newCommand->redirects = NULL;
+	newCommand->ampersand = 0;
+	newCommand->argCount = 0;
+	newCommand->argCapacity = INITIAL_ARGUMENTS;
+	newCommand->arguments = arenaAlloc(arena, sizeof(char*) * INITIAL_ARGUMENTS);
+	newCommand->arguments[0] = NULL;
+	newCommand->nextStage = NULL;
+	newCommand->stageCount = 1;
+	newCommand->placement = NULL;
+	newCommand->timeout = NULL;
+	return newCommand;
+}
+
+
+/*	FUNCTION: addArgument
+appends a token to a command's argument array, doubling the array when it fills up. the old array is just abandoned in the arena, 
+which is fine since it all gets reset at the end of the line anyway and the doubling means that wastes less than the final array's size
+*/
+static void addArgument(struct smallshCommand* command, char* token, struct smallshArena* arena) {
+
+	if (command->argCount + 1 >= command->argCapacity) {
+		char** grown = arenaAlloc(arena, sizeof(char*) * command->argCapacity * 2);
+		memcpy(grown, command->arguments, sizeof(char*) * command->argCount);
+		command->arguments = grown;
+		command->argCapacity *= 2;
+	}
+
+	command->arguments[command->argCount] = token;
+	command->argCount++;
+	command->arguments[command->argCount] = NULL;
+	command->command = command->arguments[0];
+}
+
+
+/*	FUNCTION: inputFromFD
+sets up an input source that reads command lines from a file descriptor in big blocks, this is what's used for stdin
+*/
+void inputFromFD(struct smallshInput* input, int fd, int showPrompt) {
+	input->capacity = INPUT_BLOCK_SIZE;
+	input->data = malloc(input->capacity);
+	input->length = 0;
+	input->offset = 0;
+	input->fd = fd;
+	input->mapped = 0;
+	input->showPrompt = showPrompt;
+}
+
+
+/*	FUNCTION: inputFromString
+sets up an input source for 'smallsh -c', the string can have more than one line in it
+*/
+void inputFromString(struct smallshInput* input, const char* commands) {
+	input->length = strlen(commands);
+	input->capacity = input->length + 1;
+	input->data = malloc(input->capacity);
+	memcpy(input->data, commands, input->capacity);
+	input->offset = 0;
+	input->fd = -1;
+	input->mapped = 0;
+	input->showPrompt = 0;
+}
+
+
+/*	FUNCTION: inputFromScript
+sets up an input source for running a script file. a regular file gets mmap()'d so the whole script is in memory without a single 
+read() call, anything else (like a fifo) just gets read in blocks like stdin. returns -1 if the file can't be opened
+*/
+int inputFromScript(struct smallshInput* input, const char* path) {
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return -1;
+	}
+
+	struct stat fileInfo;
+	if (fstat(fd, &fileInfo) == 0 && S_ISREG(fileInfo.st_mode) && fileInfo.st_size > 0) {
+		void* mapping = mmap(NULL, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED) {
+			madvise(mapping, fileInfo.st_size, MADV_SEQUENTIAL);
+			close(fd);
+			input->data = mapping;
+			input->length = fileInfo.st_size;
+			input->offset = 0;
+			input->capacity = 0;
+			input->fd = -1;
+			input->mapped = 1;
+			input->showPrompt = 0;
+			return 0;
+		}
+	}
+
+	inputFromFD(input, fd, 0);
+	return 0;
+}
+
+
+/*	FUNCTION: inputHasLine
+returns true if there's a whole line already sitting in the input's buffer, in that case there's no reason to sleep waiting for stdin
+*/
+static int inputHasLine(struct smallshInput* input) {
+	return memchr(input->data + input->offset, '\n', input->length - input->offset) != NULL;
+}
+
+
+/*	FUNCTION: smallshGetInput
+this function takes the next line from our input source. lines are split out of the input's block with memchr(), and more gets 
+read in only when there isn't a whole line left. the newline is replaced with a null terminator in place, except for an mmap()'d 
+script where the line gets copied into the arena instead since the lexer writes into it. the return value will be passed to our 
+command parsing function which will turn it into a command struct. it's only good until the next call, since the buffer can get 
+shifted around to make room. returns NULL once the input is used up
+*/
+char* smallshGetInput(struct smallshInput* input, struct smallshArena* arena) {
+
+	char* line;
+	size_t lineLen;
+
+	while (1) {
+		char* start = input->data + input->offset;
+		size_t available = input->length - input->offset;
+		char* newline = memchr(start, '\n', available);
+
+		if (newline != NULL) {
+			line = start;
+			lineLen = newline - start;
+			input->offset += lineLen + 1;
+			break;
+		}
+
+		//no whole line left, so either we're out of input (and whatever's left is the last line) or we need to read more
+		if (input->fd == -1) {
+			if (available == 0) {
+				return NULL;
+			}
+			line = start;
+			lineLen = available;
+			input->offset = input->length;
+			break;
+		}
+
+		//slide the partial line down to the front of the buffer and make sure there's room for more (plus a null terminator)
+		if (input->offset > 0) {
+			memmove(input->data, start, available);
+			input->length = available;
+			input->offset = 0;
+		}
+		if (input->capacity - input->length < INPUT_BLOCK_SIZE / 2) {
+			input->capacity *= 2;
+			input->data = realloc(input->data, input->capacity);
+		}
+
+		ssize_t bytesRead = read(input->fd, input->data + input->length, input->capacity - input->length - 1);
+		if (bytesRead == -1 && errno == EINTR) {
+			continue;
+		}
+		if (bytesRead <= 0) {
+			input->fd = -1;
+		}
+		else {
+			input->length += bytesRead;
+		}
+	}
+
+	if (input->mapped) {
+		return arenaStrndup(arena, line, lineLen);
+	}
+	line[lineLen] = '\0';
+	return line;
+}
+
+
+//moves the parser on to the next token
+static void parserAdvance(struct smallshParser* parser) {
+	parser->tokenOffset = parser->lexer.in - parser->line;
+	parser->result = lexNext(&parser->lexer, &parser->token);
+	if (parser->result == -1) {
+		parser->failed = 1;
+	}
+}
+
+
+//true if the next token is the given keyword. keywords only count when they aren't quoted, so 'echo "done"' stays an argument
+static int parserAtKeyword(struct smallshParser* parser, const char* keyword) {
+	return parser->result == 1 && parser->token.type == TOKEN_WORD && parser->token.flags == 0 && strcmp(parser->token.text, keyword) == 0;
+}
+
+
+//true if the next token is a ';' or a newline
+static int parserAtSeparator(struct smallshParser* parser) {
+	return parser->result == 1 && (parser->token.type == TOKEN_SEPARATOR || parser->token.type == TOKEN_NEWLINE);
+}
+
+
+//true if the next token is one of the words that end part of a construct, which can't start a command
+static int isReservedWord(struct smallshParser* parser) {
+	const char* reserved[] = { "do", "done", "then", "else", "elif", "fi", NULL };
+	for (int i = 0; reserved[i] != NULL; i++) {
+		if (parserAtKeyword(parser, reserved[i])) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+/*	FUNCTION: parserExpect
+used where a construct has to have a certain keyword next, like the 'do' of a loop. if the line ran out first the construct just 
+isn't finished yet, otherwise it's a syntax error. returns 0 once the keyword has been taken, -1 if it wasn't there
+*/
+static int parserExpect(struct smallshParser* parser, const char* keyword) {
+	if (parserAtKeyword(parser, keyword)) {
+		parserAdvance(parser);
+		return 0;
+	}
+	if (parser->result == 0) {
+		parser->incomplete = 1;
+	}
+	else if (parser->result == 1 && parser->token.type == TOKEN_WORD) {
+		fprintf(stderr, "smallsh: syntax error, expected '%s' before '%s'\n", keyword, parser->token.text);
+	}
+	else if (parser->result == 1) {
+		fprintf(stderr, "smallsh: syntax error, expected '%s'\n", keyword);
+	}
+	parser->failed = 1;
+	return -1;
+}
+
+
+//skips any ';' and newlines, which is what can come between the parts of a construct
+static void parserSkipSeparators(struct smallshParser* parser) {
+	while (parserAtSeparator(parser)) {
+		parserAdvance(parser);
+	}
+}
+
+
+//makes the job table's copy of a background pipeline's command line, cut out of the untouched copy of the line from where the 
+//pipeline started to the '&', so 'a & b &' gives the two jobs 'a &' and 'b &'
+static char* pipelineText(struct smallshParser* parser, size_t start, size_t end) {
+	const char* text = parser->fullInput + start;
+	size_t length = end - start;
+	while (length > 0 && isspace((unsigned char)*text)) {
+		text++;
+		length--;
+	}
+	while (length > 0 && isspace((unsigned char)text[length - 1])) {
+		length--;
+	}
+	char* copy = arenaAlloc(parser->arena, length + 3);
+	memcpy(copy, text, length);
+	strcpy(copy + length, " &");
+	return copy;
+}
+
+
+/*	FUNCTION: parsePipeline
+parses one pipeline, which is words, redirections and '|'s up to a ';', newline, '&&', '||', '&' or the end of the line. a '&' ends 
+the pipeline too and sends it to the background, which goes on the first stage. returns the first stage, or NULL if the parse failed
+*/
+static struct smallshCommand* parsePipeline(struct smallshParser* parser) {
+
+	//initialize our new command struct, this is also the first stage of the pipeline if there are any '|' tokens
+	struct smallshCommand* newCommand = newCommandStruct(parser->arena);
+	//this is the stage that tokens currently get added to, it moves down the chain every time we see a '|'
+	struct smallshCommand* stage = newCommand;
+	size_t start = parser->tokenOffset;
+
+	while (parser->result == 1 && !parserAtSeparator(parser) && parser->token.type != TOKEN_AND && parser->token.type != TOKEN_OR) {
+
+		struct smallshToken* token = &parser->token;
+
+		//'&' applies to the whole pipeline so it gets stored on the first stage, and whatever comes after it is a command of its own
+		if (token->type == TOKEN_AMPERSAND) {
+			if (parser->fullInput != NULL) {
+				newCommand->fullInput = pipelineText(parser, start, parser->tokenOffset);
+			}
+			newCommand->ampersand = 1;
+			parserAdvance(parser);
+			break;
+		}
+		//'<', '>' and the rest of the redirections go on the stage's redirect list along with the word after them, which is their target
+		else if (token->type == TOKEN_REDIRECT) {
+			struct smallshToken target;
+			int result = lexNext(&parser->lexer, &target);
+			if (result == -1 || parseRedirect(token, (result == 1) ? &target : NULL, stage, parser->arena) == -1) {
+				parser->failed = 1;
+				return NULL;
+			}
+		}
+		//a '|' ends the current stage, everything after it goes into a fresh command struct chained onto the last one
+		else if (token->type == TOKEN_PIPE) {
+			stage->nextStage = newCommandStruct(parser->arena);
+			stage = stage->nextStage;
+			newCommand->stageCount++;
+		}
+		//an unquoted word starting with '@' in front of the command starts the placement prefix, and it keeps going until a word that isn't 'cpu=' or 'nice='
+		else if (stage == newCommand && stage->argCount == 0 && token->flags == 0 && (token->text[0] == PLACEMENT_PREFIX || newCommand->placement != NULL)) {
+			if (newCommand->placement == NULL) {
+				newCommand->placement = arenaAlloc(parser->arena, sizeof(struct smallshPlacement));
+				newCommand->placement->hasCPUs = 0;
+				newCommand->placement->hasNice = 0;
+			}
+			int placementResult = parsePlacementWord(token->text, newCommand->placement);
+			if (placementResult == -1 || (placementResult == 0 && token->text[0] == PLACEMENT_PREFIX)) {
+				fprintf(stderr, "smallsh: bad placement '%s', expected @cpu=LIST or nice=N\n", token->text);
+				parser->failed = 1;
+				return NULL;
+			}
+			if (placementResult == 0) {
+				addArgument(stage, token->text, parser->arena);
+			}
+		}
+		//otherwise, it's a word for the argument list. the first argument of each stage is also that stage's command
+		else {
+			addArgument(stage, token->text, parser->arena);
+			if (token->flags & (TOKEN_EXPANDS | TOKEN_GLOBS)) {
+				stage->needsExpansion = 1;
+			}
+		}
+
+		parserAdvance(parser);
+	}
+	if (parser->failed) {
+		return NULL;
+	}
+
+	//a line like '< file' or 'ls |' would leave us with a stage that has nothing to run and nowhere to copy data to/from, so we throw the whole line out
+	for (struct smallshCommand* check = newCommand; check != NULL; check = check->nextStage) {
+		if (check->argCount == 0 && (newCommand->stageCount == 1 || check->redirects == NULL)) {
+			fprintf(stderr, "smallsh: syntax error, pipeline stage has no command\n");
+			parser->failed = 1;
+			return NULL;
+		}
+		//the stages with expansions keep the words the lexer gave us, each run builds its arguments from them
+		if (check->needsExpansion) {
+			check->words = check->arguments;
+			check->wordCount = check->argCount;
+		}
+	}
+
+	return newCommand;
+}
+
+
+//allocates a node of the given type with everything else empty
+static struct smallshNode* newNode(struct smallshParser* parser, enum nodeType type) {
+	struct smallshNode* node = arenaAlloc(parser->arena, sizeof(struct smallshNode));
+	memset(node, 0, sizeof(struct smallshNode));
+	node->type = type;
+	return node;
+}
+
+
+//parses a 'do ... done' loop body, the parser is on the 'do'
+static struct smallshNode* parseLoopBody(struct smallshParser* parser) {
+	const char* stopWords[] = { "done", NULL };
+	if (parserExpect(parser, "do") == -1) {
+		return NULL;
+	}
+	struct smallshNode* body = parseList(parser, stopWords);
+	if (parser->failed || parserExpect(parser, "done") == -1) {
+		return NULL;
+	}
+	return body;
+}
+
+
+/*	FUNCTION: parseFor
+parses 'for NAME in WORD...; do LIST; done', the parser is just past the 'for'. the words get expanded each time the loop starts, 
+not when it's parsed
+*/
+static struct smallshNode* parseFor(struct smallshParser* parser) {
+
+	struct smallshNode* node = newNode(parser, NODE_FOR);
+
+	if (parser->result == 1 && parser->token.type == TOKEN_WORD && parser->token.flags == 0 && (isalpha((unsigned char)parser->token.text[0]) || parser->token.text[0] == '_')) {
+		node->variable = parser->token.text;
+		for (char* c = node->variable; *c != '\0'; c++) {
+			if (!isalnum((unsigned char)*c) && *c != '_') {
+				node->variable = NULL;
+			}
+		}
+	}
+	if (node->variable == NULL) {
+		if (parser->result == 0) {
+			parser->incomplete = 1;
+		}
+		else if (parser->result == 1) {
+			fprintf(stderr, "smallsh: syntax error, 'for' needs a variable name\n");
+		}
+		parser->failed = 1;
+		return NULL;
+	}
+	parserAdvance(parser);
+
+	//the words go in an array that doubles like a command's arguments do
+	if (parserAtKeyword(parser, "in")) {
+		int capacity = INITIAL_ARGUMENTS;
+		node->words = arenaAlloc(parser->arena, sizeof(char*) * capacity);
+		for (parserAdvance(parser); parser->result == 1 && parser->token.type == TOKEN_WORD; parserAdvance(parser)) {
+			if (node->wordCount == capacity) {
+				char** grown = arenaAlloc(parser->arena, sizeof(char*) * capacity * 2);
+				memcpy(grown, node->words, sizeof(char*) * capacity);
+				node->words = grown;
+				capacity *= 2;
+			}
+			node->words[node->wordCount++] = parser->token.text;
+			if (parser->token.flags & (TOKEN_EXPANDS | TOKEN_GLOBS)) {
+				node->wordsExpand = 1;
+			}
+		}
+		if (parser->failed) {
+			return NULL;
+		}
+		if (parser->result == 1 && !parserAtSeparator(parser)) {
+			fprintf(stderr, "smallsh: syntax error, only words can go in a for loop's list\n");
+			parser->failed = 1;
+			return NULL;
+		}
+	}
+	parserSkipSeparators(parser);
+
+	node->body = parseLoopBody(parser);
+	return (node->body != NULL) ? node : NULL;
+}
+
+
+//parses 'while LIST; do LIST; done', the parser is just past the 'while'
+static struct smallshNode* parseWhile(struct smallshParser* parser) {
+	const char* stopWords[] = { "do", NULL };
+	struct smallshNode* node = newNode(parser, NODE_WHILE);
+	node->condition = parseList(parser, stopWords);
+	if (parser->failed) {
+		return NULL;
+	}
+	node->body = parseLoopBody(parser);
+	return (node->body != NULL) ? node : NULL;
+}
+
+
+/*	FUNCTION: parseIf
+parses 'if LIST; then LIST; [elif LIST; then LIST;]... [else LIST;] fi', the parser is just past the 'if' (or an 'elif', which is 
+parsed as an if of its own inside the else, sharing the one 'fi')
+*/
+static struct smallshNode* parseIf(struct smallshParser* parser) {
+
+	const char* conditionStops[] = { "then", NULL };
+	const char* bodyStops[] = { "elif", "else", "fi", NULL };
+	const char* elseStops[] = { "fi", NULL };
+	struct smallshNode* node = newNode(parser, NODE_IF);
+
+	node->condition = parseList(parser, conditionStops);
+	if (parser->failed || parserExpect(parser, "then") == -1) {
+		return NULL;
+	}
+	node->body = parseList(parser, bodyStops);
+	if (parser->failed) {
+		return NULL;
+	}
+
+	if (parserAtKeyword(parser, "elif")) {
+		parserAdvance(parser);
+		node->elseBody = parseIf(parser);
+		return (node->elseBody != NULL) ? node : NULL;
+	}
+	if (parserAtKeyword(parser, "else")) {
+		parserAdvance(parser);
+		node->elseBody = parseList(parser, elseStops);
+		if (parser->failed) {
+			return NULL;
+		}
+	}
+	return (parserExpect(parser, "fi") == 0) ? node : NULL;
+}
+
+
+/*	FUNCTION: parseList
+parses commands joined by ';', newlines, '&', '&&' and '||' until the line runs out or one of the stop words shows up where a command 
+would start. the stop word is left for the caller. each node remembers which of those came before it, so the whole list is one chain 
+that smallshExecuteNodes() can run straight through. a list that's part of a construct can't be empty, a top level one can. returns 
+the first node, or NULL if the list was empty or the parse failed
+*/
+static struct smallshNode* parseList(struct smallshParser* parser, const char** stopWords) {
+
+	struct smallshNode* first = NULL;
+	struct smallshNode** link = &first;
+	enum listConnector connector = RUN_ALWAYS;
+	int afterCommand = 0; //a bool that's true when the last thing parsed was a command, which is the only place a ';' can go
+
+	parser->depth += (stopWords != NULL);
+
+	while (1) {
+		//a '&&' or '||' needs a command after it, though it can be on the next line. blank lines can pile up but a ';' has to end a 
+		//command, so 'a ; ; b' or a line starting with ';' is a syntax error like in other shells
+		if (connector == RUN_ALWAYS) {
+			while (parserAtSeparator(parser)) {
+				if (parser->token.type == TOKEN_SEPARATOR && !afterCommand) {
+					fprintf(stderr, "smallsh: syntax error near unexpected ';'\n");
+					parser->failed = 1;
+					return NULL;
+				}
+				afterCommand = 0;
+				parserAdvance(parser);
+			}
+		}
+		else {
+			while (parser->result == 1 && parser->token.type == TOKEN_NEWLINE) {
+				parserAdvance(parser);
+			}
+		}
+		if (parser->failed) {
+			return NULL;
+		}
+		if (parser->result == 0 && connector != RUN_ALWAYS) {
+			parser->incomplete = 1;
+			parser->failed = 1;
+			return NULL;
+		}
+		if (parser->result == 0) {
+			break;
+		}
+
+		int stopped = 0;
+		for (int i = 0; stopWords != NULL && stopWords[i] != NULL && connector == RUN_ALWAYS; i++) {
+			stopped |= parserAtKeyword(parser, stopWords[i]);
+		}
+		if (stopped) {
+			break;
+		}
+		if (isReservedWord(parser)) {
+			fprintf(stderr, "smallsh: syntax error near unexpected '%s'\n", parser->token.text);
+			parser->failed = 1;
+			return NULL;
+		}
+
+		struct smallshNode* node;
+		if (parserAtKeyword(parser, "for")) {
+			parserAdvance(parser);
+			node = parseFor(parser);
+		}
+		else if (parserAtKeyword(parser, "while")) {
+			parserAdvance(parser);
+			node = parseWhile(parser);
+		}
+		else if (parserAtKeyword(parser, "if")) {
+			parserAdvance(parser);
+			node = parseIf(parser);
+		}
+		else {
+			node = newNode(parser, NODE_COMMAND);
+			node->command = parsePipeline(parser);
+		}
+		if (parser->failed) {
+			return NULL;
+		}
+		node->connector = connector;
+		*link = node;
+		link = &node->next;
+		afterCommand = 1;
+
+		//see what joins this command to the next one. a construct can't go to the background, since that would take a copy of the 
+		//shell to run it, and a background command has no status for '&&' or '||' to look at
+		connector = RUN_ALWAYS;
+		int background = (node->type == NODE_COMMAND && node->command->ampersand);
+		if (parser->result == 1 && !background && (parser->token.type == TOKEN_AND || parser->token.type == TOKEN_OR)) {
+			connector = (parser->token.type == TOKEN_AND) ? RUN_IF_SUCCEEDED : RUN_IF_FAILED;
+			parserAdvance(parser);
+		}
+		else if (parser->result == 1 && parser->token.type == TOKEN_AMPERSAND) {
+			fprintf(stderr, "smallsh: a for, while or if can't be run in the background\n");
+			parser->failed = 1;
+			return NULL;
+		}
+		else if (parser->result == 1 && !parserAtSeparator(parser) && !background) {
+			fprintf(stderr, "smallsh: syntax error, expected ';', '&&', '||' or a newline after the end of a construct\n");
+			parser->failed = 1;
+			return NULL;
+		}
+		else if (parser->result == 1 && background && (parser->token.type == TOKEN_AND || parser->token.type == TOKEN_OR)) {
+			fprintf(stderr, "smallsh: syntax error near unexpected '%s'\n", (parser->token.type == TOKEN_AND) ? "&&" : "||");
+			parser->failed = 1;
+			return NULL;
+		}
+	}
+
+	//the line ran out inside a construct, so more lines are needed
+	if (parser->result == 0 && parser->depth > 0) {
+		parser->incomplete = 1;
+		parser->failed = 1;
+		return NULL;
+	}
+	if (first == NULL && stopWords != NULL) {
+		fprintf(stderr, "smallsh: syntax error near unexpected '%s'\n", parser->token.text);
+		parser->failed = 1;
+		return NULL;
+	}
+
+	parser->depth -= (stopWords != NULL);
+	return first;
+}
+
+
+/*	FUNCTION: smallshParseInput
+this function parses the input line into a list of nodes, one token from the lexer at a time, and then returns the first one. the lexer 
+dequotes each word in place so the words just point into the line instead of getting copied, which means the line has to live as long 
+as the nodes do. '$' expansions are left as markers in the words and filled in by expandCommand() right before each command runs. 
+everything is allocated out of the arena and goes away when the arena is reset. returns NULL for an empty or comment line, or after 
+printing why the line is bad. incomplete gets set instead of printing anything when the line ends in the middle of a for, while or if, 
+or right after a '&&' or '||', and it's PARSE_FAILED for a bad line so the caller can tell that apart from an empty one
+*/
+struct smallshNode* smallshParseInput(char* inputLine, struct smallshArena* arena, int* incomplete) {
+
+	*incomplete = 0;
+	if (inputLine == NULL) {
+		return NULL;
+	}
+
+	struct smallshParser parser;
+	parser.arena = arena;
+	parser.depth = 0;
+	parser.failed = 0;
+	parser.incomplete = 0;
+	//a background job keeps its line around for 'jobs', and the lexer is about to write all over it, so save a copy first. only a 
+	//line with a '&' in it can be a background job, so every other line skips the copy
+	parser.fullInput = (strchr(inputLine, '&') != NULL) ? arenaStrndup(arena, inputLine, strlen(inputLine)) : NULL;
+	parser.line = inputLine;
+	lexerInit(&parser.lexer, inputLine);
+	parserAdvance(&parser);
+
+	struct smallshNode* parsed = parseList(&parser, NULL);
+	if (!parser.failed && parser.result == 1) {
+		fprintf(stderr, "smallsh: syntax error near unexpected '%s'\n", parser.token.text);
+		parser.failed = 1;
+	}
+	if (parser.failed) {
+		*incomplete = parser.incomplete ? 1 : PARSE_FAILED;
+		return NULL;
+	}
+	return parsed;
+}
+
+
+/*	FUNCTION: lineMayContinue
+true if a line has a 'for', 'while' or 'if' at the start of a word, or ends with '&&' or '||'. those are the only lines that can go on 
+to the next line, so they're the only ones the main loop keeps an untouched copy of before the lexer writes over them
+*/
+static int lineMayContinue(const char* line) {
+	size_t length = strlen(line);
+	while (length > 0 && isspace((unsigned char)line[length - 1])) {
+		length--;
+	}
+	if (length >= 2 && (strncmp(line + length - 2, "&&", 2) == 0 || strncmp(line + length - 2, "||", 2) == 0)) {
+		return 1;
+	}
+	for (const char* c = strpbrk(line, "fwi"); c != NULL; c = strpbrk(c + 1, "fwi")) {
+		if ((c == line || strchr(" \t;|&", c[-1]) != NULL) && (strncmp(c, "for", 3) == 0 || strncmp(c, "while", 5) == 0 || strncmp(c, "if", 2) == 0)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+//64 bit FNV-1a over a line, the length comes out of the same pass
+static unsigned long long lineHash(const char* line, size_t* lengthOut) {
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	const unsigned char* c = (const unsigned char*)line;
+	for (; *c != '\0'; c++) {
+		hash = (hash ^ *c) * 0x100000001b3ULL;
+	}
+	*lengthOut = c - (const unsigned char*)line;
+	return hash;
+}
+
+
+/*	FUNCTION: lineCacheParse
+smallshParseInput() with the line cache in front of it. a line that's in the cache gets its parsed nodes back without being lexed or 
+parsed at all. otherwise it's parsed in place into the line's arena like always, unless this is the second time in a row the line's 
+slot has seen it, in that case a copy gets parsed into the slot's own arena so it can stick around after the line is done
+*/
+struct smallshNode* lineCacheParse(struct smallshLineCache* cache, char* line, struct smallshArena* arena, int* incomplete) {
+
+	size_t length;
+	unsigned long long hash = lineHash(line, &length);
+	struct smallshCachedLine* entry = &cache->entries[hash & (LINE_CACHE_SLOTS - 1)];
+
+	if (entry->parsed != NULL && entry->hash == hash && entry->length == length && memcmp(entry->text, line, length) == 0) {
+		cache->hits++;
+		*incomplete = 0;
+		return entry->parsed;
+	}
+	cache->misses++;
+
+	if (cache->seen[hash & (LINE_CACHE_SLOTS - 1)] != hash) {
+		cache->seen[hash & (LINE_CACHE_SLOTS - 1)] = hash;
+		return smallshParseInput(line, arena, incomplete);
+	}
+
+	//take over the slot, its arena gets reused for the new line so a slot that keeps changing hands doesn't keep calling malloc()
+	arenaReset(&entry->arena);
+	entry->hash = hash;
+	entry->length = length;
+	entry->text = arenaStrndup(&entry->arena, line, length);
+	entry->parsed = smallshParseInput(arenaStrndup(&entry->arena, line, length), &entry->arena, incomplete);
+	return entry->parsed;
+}
+
+
+/*	FUNCTION: smallshCD
+pretty self explanatory change directory function. we use the chdir() and pass it either the environment variable for HOME, 
+or whatever the first argument was after 'cd', if there is one
+*/
+static int smallshCD(struct smallshCommand* inputCommand, struct smallshContext* context) {
+	
+	int chdirStatus;
+	
+	if (inputCommand->argCount == 1) {
+		chdirStatus = chdir(getenv("HOME"));
+	}
+	else if (inputCommand->argCount > 1) {
+		chdirStatus = chdir(inputCommand->arguments[1]);
+	}
+	
+	if (chdirStatus == -1) {
+		perror("chdir");
+	}
+	return BUILTIN_KEEP_STATUS;
+}
+
+
+/*	FUNCTION: smallshLauncher
+built-in that switches between the posix_spawnp() launch path and the original fork() + exec() one while the shell is running. 
+the starting value comes from the SMALLSH_LAUNCHER environment variable, see main()
+*/
+static int smallshLauncher(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	if (inputCommand->argCount == 1) {
+		printf("%s\n", launcherMode == LAUNCH_FORK ? "fork" : "spawn");
+	}
+	else if (strcmp(inputCommand->arguments[1], "fork") == 0) {
+		launcherMode = LAUNCH_FORK;
+	}
+	else if (strcmp(inputCommand->arguments[1], "spawn") == 0) {
+		launcherMode = LAUNCH_SPAWN;
+	}
+	else {
+		fprintf(stderr, "launcher: expected 'fork' or 'spawn'\n");
+	}
+	return BUILTIN_KEEP_STATUS;
+}
+
+
+/*	FUNCTION: parseCPUList
+parses a CPU list in the same format taskset -c and /sys use, like '3' or '2-5' or '0,2,8-11', into a cpu set. returns 0 if it worked 
+and -1 if the list is malformed or empty
+*/
+static int parseCPUList(const char* list, cpu_set_t* cpus) {
+
+	CPU_ZERO(cpus);
+
+	while (*list != '\0') {
+		char* end;
+		long first = strtol(list, &end, 10);
+		long last = first;
+		if (end == list || first < 0) {
+			return -1;
+		}
+		if (*end == '-') {
+			list = end + 1;
+			last = strtol(list, &end, 10);
+			if (end == list || last < first) {
+				return -1;
+			}
+		}
+		if (last >= CPU_SETSIZE) {
+			return -1;
+		}
+		for (long cpu = first; cpu <= last; cpu++) {
+			CPU_SET(cpu, cpus);
+		}
+		if (*end == ',') {
+			end++;
+		}
+		else if (*end != '\0') {
+			return -1;
+		}
+		list = end;
+	}
+
+	return (CPU_COUNT(cpus) > 0) ? 0 : -1;
+}
+
+
+//the opposite of parseCPUList(), writes a cpu set out as a list with runs collapsed into ranges
+static void formatCPUList(cpu_set_t* cpus, char* buffer, size_t size) {
+
+	size_t used = 0;
+	buffer[0] = '\0';
+
+	for (int cpu = 0; cpu < CPU_SETSIZE && used < size; cpu++) {
+		if (!CPU_ISSET(cpu, cpus)) {
+			continue;
+		}
+		int last = cpu;
+		while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, cpus)) {
+			last++;
+		}
+		if (last == cpu) {
+			used += snprintf(buffer + used, size - used, "%s%d", used > 0 ? "," : "", cpu);
+		}
+		else {
+			used += snprintf(buffer + used, size - used, "%s%d-%d", used > 0 ? "," : "", cpu, last);
+		}
+		cpu = last;
+	}
+}
+
+
+/*	FUNCTION: parsePlacementWord
+the parser hands this every word in front of the command once it has seen a word starting with '@'. 'cpu=LIST' and 'nice=N' (with or 
+without the '@') fill in the placement, returns 1 if the word was one of those, 0 if it's something else (which means the command 
+starts here) and -1 if it was one of those but the value is bad
+*/
+static int parsePlacementWord(const char* word, struct smallshPlacement* placement) {
+
+	if (word[0] == PLACEMENT_PREFIX) {
+		word++;
+	}
+
+	if (strncmp(word, "cpu=", 4) == 0) {
+		if (parseCPUList(word + 4, &placement->cpus) == -1) {
+			return -1;
+		}
+		placement->hasCPUs = 1;
+		return 1;
+	}
+	else if (strncmp(word, "nice=", 5) == 0) {
+		char* end;
+		long value = strtol(word + 5, &end, 10);
+		if (end == word + 5 || *end != '\0' || value < -20 || value > 19) {
+			return -1;
+		}
+		placement->niceValue = value;
+		placement->hasNice = 1;
+		return 1;
+	}
+	return 0;
+}
+
+
+/*	FUNCTION: choosePlacement
+works out where one process of a command should go. anything the line's own prefix says wins, whatever it leaves out comes from the 
+placement settings: background processes get the next CPU in the round robin and the background nice value, foreground ones get pinned 
+to the reserved foreground CPUs. it's called once per pipeline stage so the stages of a background pipeline land on different CPUs. 
+returns 1 if there's anything to apply and 0 if the process can just inherit the shell's placement
+*/
+static int choosePlacement(struct smallshCommand* input, int background, struct smallshPlacement* placement) {
+
+	if (input->placement != NULL) {
+		*placement = *input->placement;
+	}
+	else {
+		placement->hasCPUs = 0;
+		placement->hasNice = 0;
+	}
+
+	if (!placement->hasCPUs && background && (placementSettings.hasBackgroundCPUs || placementSettings.hasForegroundCPUs)) {
+		cpu_set_t candidates;
+		if (placementSettings.hasBackgroundCPUs) {
+			candidates = placementSettings.backgroundCPUs;
+		}
+		else if (sched_getaffinity(0, sizeof(cpu_set_t), &candidates) == -1) {
+			CPU_ZERO(&candidates);
+		}
+		if (placementSettings.hasForegroundCPUs) {
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+				if (CPU_ISSET(cpu, &placementSettings.foregroundCPUs)) {
+					CPU_CLR(cpu, &candidates);
+				}
+			}
+		}
+
+		//walk forward from where the last background process went until we hit a CPU that's in the set, wrapping around once
+		if (CPU_COUNT(&candidates) > 0) {
+			int cpu = placementSettings.nextCPU;
+			while (!CPU_ISSET(cpu % CPU_SETSIZE, &candidates)) {
+				cpu++;
+			}
+			cpu %= CPU_SETSIZE;
+			CPU_ZERO(&placement->cpus);
+			CPU_SET(cpu, &placement->cpus);
+			placement->hasCPUs = 1;
+			placementSettings.nextCPU = (cpu + 1) % CPU_SETSIZE;
+		}
+	}
+	else if (!placement->hasCPUs && !background && placementSettings.hasForegroundCPUs) {
+		placement->cpus = placementSettings.foregroundCPUs;
+		placement->hasCPUs = 1;
+	}
+
+	if (!placement->hasNice && background && placementSettings.hasBackgroundNice) {
+		placement->niceValue = placementSettings.backgroundNice;
+		placement->hasNice = 1;
+	}
+
+	return placement->hasCPUs || placement->hasNice;
+}
+
+
+/*	FUNCTION: applyPlacement
+called in a forked child right before it exec()s, both settings carry over into the new program. a placement that can't be applied 
+(a CPU we aren't allowed on, or a nice value below ours without the privileges to lower it) gets a warning but the command still runs
+*/
+static void applyPlacement(struct smallshPlacement* placement) {
+
+	if (placement->hasCPUs && sched_setaffinity(0, sizeof(cpu_set_t), &placement->cpus) == -1) {
+		perror("sched_setaffinity()");
+	}
+	if (placement->hasNice && setpriority(PRIO_PROCESS, 0, placement->niceValue) == -1) {
+		perror("setpriority()");
+	}
+}
+
+
+//writes out where a job's processes were placed for 'jobs -l', the CPUs of every stage are merged into one list
+static void describePlacement(struct smallshPlacement* placements, int count, char* buffer, size_t size) {
+
+	cpu_set_t allCPUs;
+	int hasCPUs = 0;
+	int used = 0;
+	CPU_ZERO(&allCPUs);
+	buffer[0] = '\0';
+
+	for (int i = 0; i < count; i++) {
+		if (placements[i].hasCPUs) {
+			CPU_OR(&allCPUs, &allCPUs, &placements[i].cpus);
+			hasCPUs = 1;
+		}
+	}
+	if (hasCPUs) {
+		used = snprintf(buffer, size, "cpu=");
+		formatCPUList(&allCPUs, buffer + used, size - used);
+		used = strlen(buffer);
+	}
+	//every stage gets the same nice value, so the first one is enough
+	if (count > 0 && placements[0].hasNice && (size_t)used < size) {
+		snprintf(buffer + used, size - used, "%snice=%d", hasCPUs ? " " : "", placements[0].niceValue);
+	}
+}
+
+
+/*	FUNCTION: smallshPlacementBuiltin
+built-in placement command, changes where background jobs run so they stay out of the way of foreground work:
+	placement bg 2-7		background processes get one CPU each, round robin, from CPUs 2-7
+	placement fg 0-1		reserve CPUs 0-1 for foreground commands, background processes never get put on them
+	placement nice 10		background processes run at nice 10
+any of them can be given 'off' instead, and with no arguments it prints the current settings. a line's own '@cpu=... nice=...' prefix 
+always wins over these
+*/
+static int smallshPlacementBuiltin(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	char list[PLACEMENT_DESCRIPTION_SIZE];
+
+	if (inputCommand->argCount == 1) {
+		formatCPUList(&placementSettings.backgroundCPUs, list, sizeof(list));
+		printf("bg   %s\n", placementSettings.hasBackgroundCPUs ? list : "off");
+		formatCPUList(&placementSettings.foregroundCPUs, list, sizeof(list));
+		printf("fg   %s\n", placementSettings.hasForegroundCPUs ? list : "off");
+		if (placementSettings.hasBackgroundNice) {
+			printf("nice %d\n", placementSettings.backgroundNice);
+		}
+		else {
+			printf("nice off\n");
+		}
+		return BUILTIN_KEEP_STATUS;
+	}
+
+	for (int i = 1; i < inputCommand->argCount; i += 2) {
+		char* setting = inputCommand->arguments[i];
+		char* value = inputCommand->arguments[i + 1];
+		int off = (value != NULL && strcmp(value, "off") == 0);
+
+		if (value == NULL) {
+			break;
+		}
+		else if (strcmp(setting, "bg") == 0 || strcmp(setting, "fg") == 0) {
+			int* hasCPUs = (setting[0] == 'b') ? &placementSettings.hasBackgroundCPUs : &placementSettings.hasForegroundCPUs;
+			cpu_set_t* cpus = (setting[0] == 'b') ? &placementSettings.backgroundCPUs : &placementSettings.foregroundCPUs;
+			cpu_set_t newCPUs;
+			cpu_set_t allowed;
+			if (off) {
+				*hasCPUs = 0;
+				CPU_ZERO(cpus);
+			}
+			else if (parseCPUList(value, &newCPUs) == -1) {
+				fprintf(stderr, "placement: %s: bad CPU list\n", value);
+				return BUILTIN_KEEP_STATUS;
+			}
+			else {
+				//a set with nothing the shell is allowed to run on could never be applied, so catch that now instead of at every launch
+				if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0) {
+					CPU_AND(&allowed, &allowed, &newCPUs);
+					if (CPU_COUNT(&allowed) == 0) {
+						fprintf(stderr, "placement: %s: none of these CPUs are available\n", value);
+						return BUILTIN_KEEP_STATUS;
+					}
+				}
+				*cpus = newCPUs;
+				*hasCPUs = 1;
+			}
+		}
+		else if (strcmp(setting, "nice") == 0) {
+			struct smallshPlacement parsed;
+			char word[32];
+			snprintf(word, sizeof(word), "nice=%s", value);
+			if (off) {
+				placementSettings.hasBackgroundNice = 0;
+			}
+			else if (parsePlacementWord(word, &parsed) == 1) {
+				placementSettings.backgroundNice = parsed.niceValue;
+				placementSettings.hasBackgroundNice = 1;
+			}
+			else {
+				fprintf(stderr, "placement: %s: nice value must be between -20 and 19\n", value);
+				return BUILTIN_KEEP_STATUS;
+			}
+		}
+		else {
+			break;
+		}
+
+		if (i + 2 >= inputCommand->argCount) {
+			return BUILTIN_KEEP_STATUS;
+		}
+	}
+	fprintf(stderr, "usage: placement [bg|fg CPU-LIST|off] [nice N|off]\n");
+	return BUILTIN_KEEP_STATUS;
+}
+
+
+//FNV-1a hash of a command name, masked down to a bucket in the path cache
+static int nameBucket(const char* name) {
+	unsigned int hash = 2166136261u;
+	for (; *name != '\0'; name++) {
+		hash = (hash ^ (unsigned char)*name) * 16777619u;
+	}
+	return hash & (pathCache.bucketCount - 1);
+}
+
+
+/*	FUNCTION: pathCacheClear
+forgets every remembered command, this is what 'hash -r' does and also what happens when $PATH itself changes
+*/
+static void pathCacheClear() {
+	for (int i = 0; i < pathCache.bucketCount; i++) {
+		while (pathCache.buckets[i] != NULL) {
+			struct smallshHashEntry* next = pathCache.buckets[i]->next;
+			free(pathCache.buckets[i]->name);
+			free(pathCache.buckets[i]->path);
+			free(pathCache.buckets[i]);
+			pathCache.buckets[i] = next;
+		}
+	}
+	pathCache.entryCount = 0;
+}
+
+
+//forgets a single command name, if it was remembered
+static void pathCacheForget(const char* name) {
+	struct smallshHashEntry** link = &pathCache.buckets[nameBucket(name)];
+	while (*link != NULL) {
+		if (strcmp((*link)->name, name) == 0) {
+			struct smallshHashEntry* entry = *link;
+			*link = entry->next;
+			free(entry->name);
+			free(entry->path);
+			free(entry);
+			pathCache.entryCount--;
+			return;
+		}
+		link = &(*link)->next;
+	}
+}
+
+
+/*	FUNCTION: pathCacheWatch
+(re)builds the inotify watches for the current value of $PATH. closing the old inotify fd drops every old watch in one go (and takes it 
+out of the epoll set), then each absolute $PATH directory gets a new watch. the new fd goes into the job table's epoll set with a pointer 
+to the cache as its data, so the main loop's existing epoll_wait() calls are what notice changes, and there's no extra syscall per command
+*/
+static void pathCacheWatch() {
+
+	char* path = getenv("PATH");
+
+	free(pathCache.pathValue);
+	pathCache.pathValue = strdup(path != NULL ? path : "");
+
+	if (pathCache.inotifyFD != -1) {
+		close(pathCache.inotifyFD);
+	}
+	pathCache.inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (pathCache.inotifyFD == -1) {
+		return;
+	}
+
+	char* pathCopy = strdup(pathCache.pathValue);
+	char* saveptr;
+	for (char* dir = strtok_r(pathCopy, ":", &saveptr); dir != NULL; dir = strtok_r(NULL, ":", &saveptr)) {
+		if (dir[0] == '/') {
+			inotify_add_watch(pathCache.inotifyFD, dir, PATH_WATCH_EVENTS | IN_ONLYDIR);
+		}
+	}
+	free(pathCopy);
+
+	struct epoll_event event = {0};
+	event.events = EPOLLIN;
+	event.data.ptr = &pathCache;
+	if (epoll_ctl(pathCache.epollFD, EPOLL_CTL_ADD, pathCache.inotifyFD, &event) == -1) {
+		close(pathCache.inotifyFD);
+		pathCache.inotifyFD = -1;
+	}
+}
+
+
+/*	FUNCTION: pathCacheInit
+sets up the empty path cache and starts watching $PATH, called once from main loop setup after the epoll set exists
+*/
+void pathCacheInit(int epollFD) {
+	pathCache.bucketCount = INITIAL_HASH_BUCKETS;
+	pathCache.buckets = calloc(pathCache.bucketCount, sizeof(struct smallshHashEntry*));
+	pathCache.entryCount = 0;
+	pathCache.epollFD = epollFD;
+	pathCacheWatch();
+}
+
+
+/*	FUNCTION: pathCacheHandleEvents
+called when the inotify fd shows up as readable in the epoll set. every event names the file in a $PATH directory that changed, so we 
+forget just that name. a watched directory that got deleted or moved (or an overflowed event queue) means we don't know what changed 
+anymore, so in that case the whole cache gets cleared
+*/
+static void pathCacheHandleEvents() {
+
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t length;
+
+	while ((length = read(pathCache.inotifyFD, buffer, sizeof(buffer))) > 0) {
+		for (char* next = buffer; next < buffer + length; ) {
+			struct inotify_event* event = (struct inotify_event*)next;
+			if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_Q_OVERFLOW | IN_IGNORED)) {
+				pathCacheClear();
+			}
+			else if (event->len > 0) {
+				pathCacheForget(event->name);
+			}
+			next += sizeof(struct inotify_event) + event->len;
+		}
+	}
+}
+
+
+/*	FUNCTION: findInPath
+does the same search execvp() would, but in the parent and only once per command name: every directory in $PATH gets checked for an 
+executable regular file with that name. returns a malloc'd full path, or NULL if it isn't found or if the search hit a relative $PATH 
+directory first (since what that resolves to depends on the current directory we can't remember it, so that name just goes to execvp())
+*/
+static char* findInPath(const char* name) {
+
+	char* path = pathCache.pathValue;
+	size_t nameLen = strlen(name);
+
+	while (path != NULL) {
+		char* end = strchr(path, ':');
+		size_t dirLen = (end != NULL) ? (size_t)(end - path) : strlen(path);
+
+		if (dirLen == 0 || path[0] != '/') {
+			return NULL;
+		}
+
+		char* candidate = malloc(dirLen + nameLen + 2);
+		memcpy(candidate, path, dirLen);
+		candidate[dirLen] = '/';
+		memcpy(candidate + dirLen + 1, name, nameLen + 1);
+
+		struct stat fileInfo;
+		if (stat(candidate, &fileInfo) == 0 && S_ISREG(fileInfo.st_mode) && access(candidate, X_OK) == 0) {
+			return candidate;
+		}
+		free(candidate);
+
+		path = (end != NULL) ? end + 1 : NULL;
+	}
+	return NULL;
+}
+
+
+/*	FUNCTION: pathCacheLookup
+returns the full path that a command name should be exec()'d from, searching $PATH and remembering the answer the first time a name 
+is seen. names with a '/' in them are already paths and are never cached. returns NULL when the launchers should fall back to 
+execvp()'s own search. the returned string belongs to the cache
+*/
+static char* pathCacheLookup(const char* name) {
+
+	if (strchr(name, '/') != NULL || pathCache.buckets == NULL) {
+		return NULL;
+	}
+
+	//the watches (and everything we remembered) are only good for the $PATH they were made for
+	char* path = getenv("PATH");
+	if (strcmp(path != NULL ? path : "", pathCache.pathValue) != 0) {
+		pathCacheClear();
+		pathCacheWatch();
+	}
+
+	for (struct smallshHashEntry* entry = pathCache.buckets[nameBucket(name)]; entry != NULL; entry = entry->next) {
+		if (strcmp(entry->name, name) == 0) {
+			entry->hits++;
+			return entry->path;
+		}
+	}
+
+	char* found = findInPath(name);
+	if (found == NULL) {
+		return NULL;
+	}
+
+	//grow the table when it's getting full so the chains stay short
+	if (pathCache.entryCount >= pathCache.bucketCount) {
+		struct smallshHashEntry** oldBuckets = pathCache.buckets;
+		int oldCount = pathCache.bucketCount;
+		pathCache.bucketCount *= 2;
+		pathCache.buckets = calloc(pathCache.bucketCount, sizeof(struct smallshHashEntry*));
+		for (int i = 0; i < oldCount; i++) {
+			while (oldBuckets[i] != NULL) {
+				struct smallshHashEntry* next = oldBuckets[i]->next;
+				int bucket = nameBucket(oldBuckets[i]->name);
+				oldBuckets[i]->next = pathCache.buckets[bucket];
+				pathCache.buckets[bucket] = oldBuckets[i];
+				oldBuckets[i] = next;
+			}
+		}
+		free(oldBuckets);
+	}
+
+	struct smallshHashEntry* entry = malloc(sizeof(struct smallshHashEntry));
+	entry->name = strdup(name);
+	entry->path = found;
+	entry->hits = 1;
+	int bucket = nameBucket(name);
+	entry->next = pathCache.buckets[bucket];
+	pathCache.buckets[bucket] = entry;
+	pathCache.entryCount++;
+
+	return found;
+}
+
+
+/*	FUNCTION: smallshHash
+built-in hash command. with no arguments it lists every remembered command and how many times it's been used, 'hash -r' forgets 
+all of them, and 'hash name...' looks the names up now so they're remembered before they're needed
+*/
+static int smallshHash(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	if (inputCommand->argCount == 1) {
+		if (pathCache.entryCount == 0) {
+			printf("hash: hash table empty\n");
+			return BUILTIN_KEEP_STATUS;
+		}
+		printf("hits\tcommand\n");
+		for (int i = 0; i < pathCache.bucketCount; i++) {
+			for (struct smallshHashEntry* entry = pathCache.buckets[i]; entry != NULL; entry = entry->next) {
+				printf("%4d\t%s\n", entry->hits, entry->path);
+			}
+		}
+	}
+	else if (strcmp(inputCommand->arguments[1], "-r") == 0) {
+		pathCacheClear();
+	}
+	else {
+		for (int i = 1; i < inputCommand->argCount; i++) {
+			char* found = pathCacheLookup(inputCommand->arguments[i]);
+			if (found == NULL) {
+				fprintf(stderr, "hash: %s: not found\n", inputCommand->arguments[i]);
+			}
+			else {
+				//looking it up counted as a use, but it wasn't really one
+				for (struct smallshHashEntry* entry = pathCache.buckets[nameBucket(inputCommand->arguments[i])]; entry != NULL; entry = entry->next) {
+					if (entry->path == found) {
+						entry->hits--;
+					}
+				}
+			}
+		}
+	}
+	return BUILTIN_KEEP_STATUS;
+}
+
+
+/*	FUNCTION: parseRedirect
+adds a redirection token from the lexer to the stage, with the word token after it as its target. target is NULL if the line ended 
+right after the operator. for '>&' and '<&' the target is a descriptor to copy or '-' to close the descriptor. returns 0, or -1 
+(after printing why) if the redirection has a bad target
+*/
+static int parseRedirect(struct smallshToken* token, struct smallshToken* target, struct smallshCommand* stage, struct smallshArena* arena) {
+
+	if (target == NULL || target->type != TOKEN_WORD) {
+		fprintf(stderr, "smallsh: syntax error, a redirection needs something to redirect to\n");
+		return -1;
+	}
+	//like in sh, a redirect target doesn't get globbed, so '> *.log' makes a file called '*.log'
+	if (target->flags & TOKEN_GLOBS) {
+		globLiteral(target->text);
+	}
+
+	if (token->redirect == REDIRECT_DUP) {
+		if (strcmp(target->text, "-") == 0) {
+			addRedirect(stage, token->fd, REDIRECT_CLOSE, NULL, arena);
+			return 0;
+		}
+		char* end;
+		long source = strtol(target->text, &end, 10);
+		if (end == target->text || *end != '\0' || source < 0 || source > INT_MAX || (target->flags & TOKEN_EXPANDS)) {
+			fprintf(stderr, "smallsh: syntax error, '%s' is not a file descriptor\n", target->text);
+			return -1;
+		}
+		addRedirect(stage, token->fd, REDIRECT_DUP, NULL, arena)->sourceFD = source;
+		return 0;
+	}
+
+	struct smallshRedirect* redirect = addRedirect(stage, token->fd, token->redirect, target->text, arena);
+	if (target->flags & TOKEN_EXPANDS) {
+		redirect->word = target->text;
+		stage->needsExpansion = 1;
+	}
+	return 0;
+}
+
+
+//puts a new redirection on the end of a stage's list and returns it
+static struct smallshRedirect* addRedirect(struct smallshCommand* stage, int fd, enum redirectType type, char* target, struct smallshArena* arena) {
+
+	struct smallshRedirect* redirect = arenaAlloc(arena, sizeof(struct smallshRedirect));
+	redirect->fd = fd;
+	redirect->type = type;
+	redirect->target = target;
+	redirect->word = NULL;
+	redirect->sourceFD = -1;
+	redirect->savedFD = REDIRECT_NOT_SAVED;
+	redirect->next = NULL;
+
+	struct smallshRedirect** link = &stage->redirects;
+	while (*link != NULL) {
+		link = &(*link)->next;
+	}
+	*link = redirect;
+	return redirect;
+}
+
+
+//true if any of a stage's redirections change fd, which means the stage doesn't need the background /dev/null default for it
+static int redirectsFD(struct smallshCommand* stage, int fd) {
+	for (struct smallshRedirect* redirect = stage->redirects; redirect != NULL; redirect = redirect->next) {
+		if (redirect->fd == fd) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+/*	FUNCTION: openHereString
+a here-string ('<<< text') becomes a memfd holding the text and a newline, rewound to the start so the command reads it like a file. 
+nothing touches the disk and unlike a pipe there's no size limit on what we can write before the command starts reading. if memfd_create() 
+isn't available we fall back to a pipe, which only works for text that fits in the pipe's buffer. returns the descriptor or -1
+*/
+static int openHereString(const char* content) {
+
+	size_t length = strlen(content);
+	int fd = memfd_create("smallsh-herestring", MFD_CLOEXEC);
+
+	if (fd != -1) {
+		if (write(fd, content, length) != (ssize_t)length || write(fd, "\n", 1) != 1 || lseek(fd, 0, SEEK_SET) == -1) {
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	int pipeFDs[2];
+	if (pipe2(pipeFDs, O_CLOEXEC | O_NONBLOCK) == -1) {
+		return -1;
+	}
+	if (write(pipeFDs[1], content, length) != (ssize_t)length || write(pipeFDs[1], "\n", 1) != 1) {
+		errno = EFBIG;
+		close(pipeFDs[0]);
+		close(pipeFDs[1]);
+		return -1;
+	}
+	close(pipeFDs[1]);
+	//the reader gets a normal blocking pipe, O_NONBLOCK was only there so a too-big string fails instead of hanging the shell
+	fcntl(pipeFDs[0], F_SETFL, 0);
+	return pipeFDs[0];
+}
+
+
+/*	FUNCTION: openRedirects
+opens every file a stage redirects to, here in the parent before anything is launched, so a bad file name gets reported without paying 
+for a fork() that would only print an error and exit. everything is opened with O_CLOEXEC and moved up out of the way of descriptors 
+a redirect might target, that way the child just has to dup2() each one into place and the originals disappear at exec(). if anything 
+can't be opened the ones that were get closed again and -1 is returned
+*/
+static int openRedirects(struct smallshCommand* stage) {
+
+	for (struct smallshRedirect* redirect = stage->redirects; redirect != NULL; redirect = redirect->next) {
+		int fd;
+		switch (redirect->type) {
+			case REDIRECT_INPUT:
+				fd = open(redirect->target, O_RDONLY | O_CLOEXEC);
+				break;
+			case REDIRECT_OUTPUT:
+				fd = open(redirect->target, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+				break;
+			case REDIRECT_APPEND:
+				fd = open(redirect->target, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0640);
+				break;
+			case REDIRECT_STRING:
+				fd = openHereString(redirect->target);
+				break;
+			default:
+				continue;
+		}
+
+		if (fd == -1) {
+			perror((redirect->type == REDIRECT_INPUT || redirect->type == REDIRECT_STRING) ? "source open()" : "target open()");
+			closeRedirects(stage);
+			return -1;
+		}
+		if (fd < REDIRECT_HIGH_FD) {
+			int highFD = fcntl(fd, F_DUPFD_CLOEXEC, REDIRECT_HIGH_FD);
+			if (highFD != -1) {
+				close(fd);
+				fd = highFD;
+			}
+		}
+		redirect->sourceFD = fd;
+	}
+	return 0;
+}
+
+
+//closes the parent's copies of everything openRedirects() opened, once the stage has been launched (or has failed to)
+static void closeRedirects(struct smallshCommand* stage) {
+	for (struct smallshRedirect* redirect = stage->redirects; redirect != NULL; redirect = redirect->next) {
+		if (redirect->type != REDIRECT_DUP && redirect->sourceFD != -1) {
+			close(redirect->sourceFD);
+			redirect->sourceFD = -1;
+		}
+	}
+}
+
+
+/*	FUNCTION: setupChildRedirects
+this gets called in a freshly forked child (after any pipe ends have already been put on stdin/stdout) and installs the stage's 
+redirections, which openRedirects() already opened in the parent, in the order they were written. background jobs that don't redirect 
+stdin or stdout themselves get /dev/null, but only on the ends of the pipeline that aren't already connected to another stage. if the 
+job's output is being kept, outputFD is its pipe and that's where stdout goes instead, along with stderr
+*/
+static void setupChildRedirects(struct smallshCommand* stage, int background, int outputFD, int isFirst, int isLast) {
+
+	//if the process is run in the background with no input file, we redirect stdin to dev/null
+	if (background && isFirst && !redirectsFD(stage, 0)) {
+		int inputFD = open("/dev/null", O_RDONLY);
+		if (inputFD == -1 || dup2(inputFD, 0) == -1) {
+			perror("source dup2()");
+			exit(1);
+		}
+		close(inputFD);
+	}
+	//likewise we redirect stdout to dev/null if there is no output file specified
+	if (background && isLast && !redirectsFD(stage, 1)) {
+		int nullFD = (outputFD != -1) ? outputFD : open("/dev/null", O_WRONLY);
+		if (nullFD == -1 || dup2(nullFD, 1) == -1) {
+			perror("target dup2()");
+			exit(1);
+		}
+		if (nullFD != outputFD) {
+			close(nullFD);
+		}
+	}
+	if (outputFD != -1 && !redirectsFD(stage, 2)) {
+		dup2(outputFD, 2);
+	}
+
+	for (struct smallshRedirect* redirect = stage->redirects; redirect != NULL; redirect = redirect->next) {
+		if (redirect->type == REDIRECT_CLOSE) {
+			close(redirect->fd);
+		}
+		//dup2() onto itself would leave O_CLOEXEC set on something like '1>&1', so that case just has the flag cleared instead
+		else if (redirect->sourceFD == redirect->fd) {
+			fcntl(redirect->fd, F_SETFD, 0);
+		}
+		else if (dup2(redirect->sourceFD, redirect->fd) == -1) {
+			fprintf(stderr, "smallsh: %d: %s\n", redirect->sourceFD, strerror(errno));
+			exit(1);
+		}
+	}
+}
+
+
+/*	FUNCTION: spliceRedirectStage
+a pipeline stage that is only a file redirect (like the first stage of '< in.txt | sort' or the last stage of 'ls | > out.txt') doesn't 
+need a whole 'cat' process exec()'d just to shovel bytes around. the child that gets forked for the stage calls this instead and moves 
+stdin to stdout with splice(), so the data goes from the file straight into the pipe (or the pipe straight into the file) without ever 
+being copied into our memory. splice() needs at least one end to be a pipe, so if neither is we fall back to a plain read/write loop
+*/
+static void spliceRedirectStage() {
+
+	ssize_t moved;
+
+	while ((moved = splice(0, NULL, 1, NULL, SPLICE_CHUNK, SPLICE_F_MOVE)) > 0);
+
+	if (moved == -1 && errno == EINVAL) {
+		char buffer[SPLICE_CHUNK];
+		while ((moved = read(0, buffer, sizeof(buffer))) > 0) {
+			if (write(1, buffer, moved) != moved) {
+				moved = -1;
+				break;
+			}
+		}
+	}
+
+	if (moved == -1) {
+		perror("splice()");
+		exit(1);
+	}
+	exit(0);
+}
+
+
+/*	FUNCTION: spawnStage
+this is the posix_spawnp() version of forking a child for one pipeline stage. glibc's posix_spawn uses a CLONE_VM|CLONE_VFORK clone under 
+the hood, so the child borrows our memory instead of getting a copy of our page tables, and it doesn't matter how big the shell gets. 
+since there's no child-side code we can run, everything the fork() path does by hand after fork() has to be described up front instead: 
+pipe ends and redirections become dup2/close file actions, the SIGINT reset becomes a 'set to default' spawn attribute and the setpgid() 
+and tcsetpgrp() of job control become a process group attribute and glibc's tcsetpgrp file action. the redirect 
+files have already been opened by openRedirects() in launchPipeline(), so a bad file name never gets this far. if the path cache knows 
+where the command lives, execPath is that full path and we skip posix_spawnp()'s $PATH search. there's no spawn attribute for CPU 
+affinity, see below for how it gets applied anyway. group is the process group the child goes in with job control (0 for a new one 
+named after it) and -1 without. returns the new PID, or -1 if nothing got launched in which case failStatus gets the status the fork() 
+path's child would have exited with
+*/
+static pid_t spawnStage(struct smallshCommand* stage, char* execPath, int background, int outputFD, int isFirst, int isLast, int inFD, int outFD, struct smallshPlacement* placement, pid_t group, int* failStatus) {
+
+	pid_t newPid = -1;
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attributes;
+
+	posix_spawn_file_actions_init(&actions);
+	posix_spawnattr_init(&attributes);
+	short flags = 0;
+
+	//a foreground pipeline's first process takes the terminal itself, before anything else happens, so a program that reads it right away 
+	//doesn't get stopped for reading from the background. this has to come before a redirect can put something else on the shell's descriptor
+	if (group == 0 && !background && jobControl.terminalFD != -1) {
+		posix_spawn_file_actions_addtcsetpgrp_np(&actions, jobControl.terminalFD);
+	}
+
+	//the pipes from neighboring stages go on first so a redirection wins over them, same as the order the fork() path does its dup2()s in
+	if (inFD != -1) {
+		posix_spawn_file_actions_adddup2(&actions, inFD, 0);
+	}
+	else if (background && isFirst && !redirectsFD(stage, 0)) {
+		posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+	}
+
+	if (outFD != -1) {
+		posix_spawn_file_actions_adddup2(&actions, outFD, 1);
+	}
+	else if (background && isLast && !redirectsFD(stage, 1) && outputFD != -1) {
+		posix_spawn_file_actions_adddup2(&actions, outputFD, 1);
+	}
+	else if (background && isLast && !redirectsFD(stage, 1)) {
+		posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+	}
+	if (outputFD != -1 && !redirectsFD(stage, 2)) {
+		posix_spawn_file_actions_adddup2(&actions, outputFD, 2);
+	}
+
+	//then the redirections in the order they were written. a dup2 onto the same descriptor clears its close-on-exec flag, which is what '1>&1' wants
+	for (struct smallshRedirect* redirect = stage->redirects; redirect != NULL; redirect = redirect->next) {
+		if (redirect->type == REDIRECT_CLOSE) {
+			posix_spawn_file_actions_addclose(&actions, redirect->fd);
+		}
+		else {
+			posix_spawn_file_actions_adddup2(&actions, redirect->sourceFD, redirect->fd);
+		}
+	}
+
+	//the shell ignores SIGINT, and ignored signals stay ignored across exec(), so foreground children have to ask for the default back. 
+	//with job control so does every child, since a background job can be brought to the foreground later, and the same goes for the stop 
+	//signals. a blocked signal stays blocked across exec() too, and the shell blocks SIGCHLD with job control or while 'parallel' has 
+	//a task without a pidfd, so every child starts with nothing blocked
+	sigset_t defaultSignals;
+	sigemptyset(&defaultSignals);
+	if (!background || jobControl.enabled) {
+		sigaddset(&defaultSignals, SIGINT);
+		flags |= POSIX_SPAWN_SETSIGDEF;
+	}
+	if (jobControl.enabled) {
+		sigaddset(&defaultSignals, SIGTSTP);
+		sigaddset(&defaultSignals, SIGTTIN);
+		sigaddset(&defaultSignals, SIGTTOU);
+	}
+	sigset_t noSignals;
+	sigemptyset(&noSignals);
+	posix_spawnattr_setsigmask(&attributes, &noSignals);
+	flags |= POSIX_SPAWN_SETSIGMASK;
+	posix_spawnattr_setsigdefault(&attributes, &defaultSignals);
+	if (group != -1) {
+		posix_spawnattr_setpgroup(&attributes, group);
+		flags |= POSIX_SPAWN_SETPGROUP;
+	}
+	posix_spawnattr_setflags(&attributes, flags);
+
+	//the child starts out with the affinity of the thread that spawned it, so we borrow the child's CPUs for the length of the spawn and put 
+	//ours back right after. that way it's in place before the first instruction of the new program instead of getting fixed up later
+	cpu_set_t shellCPUs;
+	int borrowedCPUs = 0;
+	if (placement != NULL && placement->hasCPUs && sched_getaffinity(0, sizeof(cpu_set_t), &shellCPUs) == 0) {
+		if (sched_setaffinity(0, sizeof(cpu_set_t), &placement->cpus) == -1) {
+			perror("sched_setaffinity()");
+		}
+		else {
+			borrowedCPUs = 1;
+		}
+	}
+
+	int result = ENOENT;
+	if (execPath != NULL) {
+		result = posix_spawn(&newPid, execPath, &actions, &attributes, stage->arguments, environ);
+		//a remembered path that's gone means inotify missed something (or isn't available), so forget it and do a real search
+		if (result == ENOENT) {
+			pathCacheForget(stage->arguments[0]);
+		}
+	}
+	if (result == ENOENT) {
+		result = posix_spawnp(&newPid, stage->arguments[0], &actions, &attributes, stage->arguments, environ);
+	}
+	if (result != 0) {
+		fprintf(stderr, "%s: %s\n", stage->arguments[0], strerror(result));
+		*failStatus = W_EXITCODE(2, 0);
+		newPid = -1;
+	}
+
+	if (borrowedCPUs) {
+		sched_setaffinity(0, sizeof(cpu_set_t), &shellCPUs);
+	}
+
+	posix_spawn_file_actions_destroy(&actions);
+	posix_spawnattr_destroy(&attributes);
+
+	return newPid;
+}
+
+
+/*	FUNCTION: launchPipeline
+this function forks one child for every stage of the command struct's pipeline and starts them all at once, connecting each stage's stdout 
+to the next stage's stdin with a pipe. the pipes are made with O_CLOEXEC so the only copies that survive into the exec()'d programs are 
+the ones we dup2() onto stdin/stdout, that way nothing holds a stray write end open and every reader sees EOF when it should. the PIDs of 
+the children are written into the pids array (which must have room for stageCount entries), in stage order. a stage that couldn't be 
+launched at all gets a PID of -1 and the status it should report goes in the same slot of the statuses array, and if any stage has a 
+redirect file that can't be opened that's every stage, since none of them get launched. each stage's CPU affinity 
+and nice value come from choosePlacement(), if placements isn't NULL what every stage got is written there too. outputFD is the write 
+end of a background job's output pipe when 'set -o joboutput' is on, and -1 otherwise.
+stages are launched with posix_spawnp() unless the fork() launcher was picked, redirect-only stages always get forked since they don't exec(). 
+so do stages that need a nice value: the shell can't lend its own nice value to the spawn like it does its CPUs (an unprivileged process 
+can never lower it back), and setting it on the child after posix_spawn() returns would be too late for anything the program forks first. 
+either way the command name is looked up in the path cache first so the child can exec() the full path without searching $PATH. 
+with newGroup set (job control is on) the stages go in a process group of their own, named after the first one that launched, and a 
+foreground pipeline's first process is handed the terminal as it starts
+*/
+int launchPipeline(struct smallshCommand* input, int background, int newGroup, int outputFD, pid_t* pids, int* statuses, struct smallshPlacement* placements, struct sigaction sa) {
+
+	int launched = 0;
+	pid_t group = newGroup ? 0 : -1; //the pipeline's process group once its first process has launched, 0 until then and -1 without job control
+	int prevReadFD = -1; //the read end of the pipe coming out of the previous stage, -1 for the first stage
+	int pipeFDs[2];
+	int execFDs[2]; //the pipe that tells a trace when a forked child has exec()'d, -1 when not tracing
+	long long traceStarted;
+
+	//anything the shell printed has to go out before the children start writing to the same place (and before fork() copies the buffer). this is free when there's nothing buffered
+	fflush(stdout);
+	int track = traceNewTrack(input, background);
+
+	//every stage's redirect files are opened before anything gets launched. if one can't be opened none of the pipeline runs, instead of 
+	//the stages in front of it already running by the time we find out, and every stage just gets the status its child would have exited with
+	for (struct smallshCommand* stage = input; stage != NULL; stage = stage->nextStage) {
+		if (openRedirects(stage) == -1) {
+			for (struct smallshCommand* opened = input; opened != stage; opened = opened->nextStage) {
+				closeRedirects(opened);
+			}
+			for (stage = input; stage != NULL; stage = stage->nextStage) {
+				pids[launched] = -1;
+				statuses[launched] = W_EXITCODE(1, 0);
+				launched++;
+			}
+			return launched;
+		}
+	}
+
+	for (struct smallshCommand* stage = input; stage != NULL; stage = stage->nextStage) {
+
+		pipeFDs[0] = -1;
+		pipeFDs[1] = -1;
+		execFDs[0] = -1;
+		execFDs[1] = -1;
+		if (stage->nextStage != NULL && pipe2(pipeFDs, O_CLOEXEC) == -1) {
+			perror("pipe2()");
+			for (struct smallshCommand* unlaunched = stage; unlaunched != NULL; unlaunched = unlaunched->nextStage) {
+				closeRedirects(unlaunched);
+			}
+			break;
+		}
+
+		pid_t newPid;
+		char* execPath = (stage->argCount > 0) ? pathCacheLookup(stage->arguments[0]) : NULL;
+		struct smallshPlacement placement;
+		int placed = choosePlacement(input, background, &placement);
+		if (placements != NULL) {
+			placements[launched] = placement;
+		}
+
+		if (launcherMode == LAUNCH_SPAWN && stage->argCount > 0 && !(placed && placement.hasNice)) {
+			//posix_spawn() doesn't come back until the child has exec()'d (or failed to), so this covers both
+			traceStarted = traceNow();
+			pids[launched] = spawnStage(stage, execPath, background, outputFD, stage == input, stage->nextStage == NULL, prevReadFD, pipeFDs[1], placed ? &placement : NULL, group, &statuses[launched]);
+			traceEvent((pids[launched] != -1) ? "spawn+exec" : "spawn failed", traceStarted, track, pids[launched], -1);
+			launched++;
+		}
+		else {
+			//when tracing, a forked child gets a close-on-exec pipe that closes the moment its exec() works, so we can see when that was. 
+			//the child writes a byte to it first if it's about to give up instead
+			if (trace.events != NULL && stage->argCount > 0 && pipe2(execFDs, O_CLOEXEC) == -1) {
+				execFDs[0] = -1;
+				execFDs[1] = -1;
+			}
+			traceStarted = traceNow();
+			switch (newPid = fork()) {
+				case -1:
+					perror("fork()\n");
+					exit(1);
+					break;
+				case 0:
+					//this child process is being run in the foreground so we want SIGINT to stop it, so we change the handler back to SIG_DFL because that will actually be inherited by exec() 
+					if (!background || jobControl.enabled) {
+						sa.sa_handler = SIG_DFL;
+						sigaction(SIGINT, &sa, NULL);
+					}
+					//with job control it goes in the pipeline's process group and takes the terminal if it's the first of a foreground one, while 
+					//it still ignores SIGTTOU like the shell. then it gets back the stop signals, and the SIGCHLD the shell might be blocking
+					if (group != -1) {
+						setpgid(0, group);
+						if (group == 0 && !background && jobControl.terminalFD != -1) {
+							tcsetpgrp(jobControl.terminalFD, getpid());
+						}
+					}
+					if (jobControl.enabled) {
+						sa.sa_handler = SIG_DFL;
+						sigaction(SIGTSTP, &sa, NULL);
+						sigaction(SIGTTIN, &sa, NULL);
+						sigaction(SIGTTOU, &sa, NULL);
+					}
+					sigset_t noSignals;
+					sigemptyset(&noSignals);
+					sigprocmask(SIG_SETMASK, &noSignals, NULL);
+
+					//hook this stage up to its neighbors. dup2() clears O_CLOEXEC on the new descriptor so stdin/stdout survive the exec(), and we close the originals ourselves in case this stage never gets that far
+					if (prevReadFD != -1) {
+						dup2(prevReadFD, 0);
+						close(prevReadFD);
+					}
+					if (pipeFDs[1] != -1) {
+						dup2(pipeFDs[1], 1);
+						close(pipeFDs[0]);
+						close(pipeFDs[1]);
+					}
+
+					setupChildRedirects(stage, background, outputFD, stage == input, stage->nextStage == NULL);
+
+					if (placed) {
+						applyPlacement(&placement);
+					}
+
+					if (stage->argCount == 0) {
+						spliceRedirectStage();
+					}
+
+					//call exec() using our command struct members, going straight to the remembered path if there is one. if that fails we still let execvp() search for it
+					if (execPath != NULL) {
+						execv(execPath, stage->arguments);
+					}
+					execvp(stage->arguments[0], stage->arguments);
+					perror(stage->arguments[0]);
+					if (execFDs[1] != -1) {
+						write(execFDs[1], "x", 1);
+					}
+					exit(2);
+					break;
+				default:
+					//the child does this too, whichever of us gets there first means nothing can run before it's in its group
+					if (group != -1) {
+						setpgid(newPid, (group == 0) ? newPid : group);
+						if (group == 0 && !background && jobControl.terminalFD != -1) {
+							tcsetpgrp(jobControl.terminalFD, newPid);
+						}
+					}
+					pids[launched] = newPid;
+					launched++;
+					traceEvent("fork", traceStarted, track, newPid, -1);
+					if (execFDs[0] != -1) {
+						char failed;
+						traceStarted = traceNow();
+						close(execFDs[1]);
+						traceEvent((read(execFDs[0], &failed, 1) == 0) ? "exec" : "exec failed", traceStarted, track, newPid, -1);
+						close(execFDs[0]);
+					}
+					break;
+			}
+		}
+
+		//the rest of the pipeline joins the group its first process started
+		if (group == 0 && pids[launched - 1] != -1) {
+			group = pids[launched - 1];
+		}
+
+		//the parent doesn't need either end of the pipe once both of the stages that use it have been forked, or its copies of the redirect files
+		closeRedirects(stage);
+		if (prevReadFD != -1) {
+			close(prevReadFD);
+		}
+		if (pipeFDs[1] != -1) {
+			close(pipeFDs[1]);
+		}
+		prevReadFD = pipeFDs[0];
+	}
+
+	if (prevReadFD != -1) {
+		close(prevReadFD);
+	}
+
+	return launched;
+}
+
+
+/*	FUNCTION: describePipeline
+writes a pipeline's command line into buffer, cut off to fit. that's its text if the parser kept it (only lines with a '&' do) and its 
+words otherwise, for the trace's track names and the 'jobs' line of a foreground pipeline that gets stopped
+*/
+void describePipeline(struct smallshCommand* input, char* buffer, size_t size) {
+
+	if (input->fullInput != NULL) {
+		snprintf(buffer, size, "%s", input->fullInput);
+		return;
+	}
+	size_t length = 0;
+	buffer[0] = '\0';
+	for (struct smallshCommand* stage = input; stage != NULL && length < size; stage = stage->nextStage) {
+		for (int i = 0; i < stage->argCount && length < size; i++) {
+			length += snprintf(buffer + length, size - length, "%s ", stage->arguments[i]);
+		}
+		if (stage->nextStage != NULL && length < size) {
+			length += snprintf(buffer + length, size - length, "| ");
+		}
+	}
+	length = strlen(buffer);
+	while (length > 0 && buffer[length - 1] == ' ') {
+		buffer[--length] = '\0';
+	}
+}
+
+
+/*	FUNCTION: waitPipeline
+waits for the processes of a foreground pipeline in stage order. the stages are reaped with wait4() (see waitForeground()) so we also 
+get what they cost, which is added into usage. pids has a -1 for each stage that isn't running (it never launched, or 'fg' found it 
+already reaped) and that stage's status is in statuses. like other shells, the status we keep is the one from the last stage, and if a 
+signal killed it that gets printed right away. with job control a stage that stops (^Z) ends the wait early: the status becomes 128 
+plus the signal like sh's $? and the stage's index is returned so the caller can make a job out of it and the stages after it. returns -1 
+once every stage is done. the terminal comes back to the shell either way
+*/
+int waitPipeline(pid_t* pids, int* statuses, int count, int* childStatus, struct smallshUsage* usage, struct smallshDeadline* deadline, int track) {
+
+	int stageStatus;
+	struct rusage stageUsage;
+
+	//since this child process is being run in the foreground, we want the childStatus to work with our 'status' function and persist to the next command, so the childStatus variable here is passed by reference and exists in the scope of the main loop
+	for (int i = 0; i < count; i++) {
+		if (pids[i] == -1) {
+			stageStatus = statuses[i];
+		}
+		else {
+			long long traceStarted = traceNow();
+			waitForeground(pids + i, count - i, &stageStatus, &stageUsage, deadline);
+			if (WIFSTOPPED(stageStatus)) {
+				traceEvent("stopped", traceStarted, track, pids[i], -1);
+				*childStatus = W_EXITCODE(128 + WSTOPSIG(stageStatus), 0);
+				jobControlReclaim(1);
+				return i;
+			}
+			traceEvent("wait", traceStarted, track, pids[i], stageStatus);
+			addRusage(usage, &stageUsage);
+		}
+		if (i == count - 1) {
+			*childStatus = stageStatus;
+		}
+	}
+
+	//a program killed in the middle of changing the terminal's settings won't have put them back. SIGPIPE is left out like other shells 
+	//do, it's the normal way for the writing end of a pipeline to find out the reader is gone
+	int signaled = (count > 0 && WIFSIGNALED(*childStatus));
+	jobControlReclaim(signaled);
+	if (signaled && WTERMSIG(*childStatus) != SIGPIPE) {
+		fflush(stdout);
+		fprintf(stderr, "%sChild exited abnormally due to signal: %d%s\n", (WTERMSIG(*childStatus) == SIGINT && jobControl.enabled) ? "\n" : "",
+			WTERMSIG(*childStatus), (deadline->expired > 0) ? " after running out of time" : "");
+	}
+	return -1;
+}
+
+
+/*	FUNCTION: callExecForeground
+this function takes our command struct as input and launches its pipeline, with each stage being a new process that calls an exec() function 
+which is passed that stage's arguments. the child processes created here run in the foreground and thus smallsh will be blocked until 
+all of them are finished (or stopped, in which case what's left becomes a stopped job), see waitPipeline(). what they cost is added up 
+into usage for 'status -v' and 'time'. the pipeline runs with the time limit a 'timeout' gave it or the shell's default one, and returns 
+1 if that ran out and it got signaled, 0 otherwise
+*/
+int callExecForeground(struct smallshCommand* input, int* childStatus, struct smallshUsage* usage, struct sigaction sa) {
+	
+	pid_t pids[input->stageCount];
+	int statuses[input->stageCount];
+	struct smallshDeadline deadline;
+	long long startNanos = monotonicNanos();
+	int launched = launchPipeline(input, 0, jobControl.enabled, -1, pids, statuses, NULL, sa);
+	int track = traceLastTrack();
+	deadlineStart(&deadline, (input->timeout != NULL) ? input->timeout : &defaultTimeout);
+
+	memset(usage, 0, sizeof(struct smallshUsage));
+
+	int stopped = waitPipeline(pids, statuses, launched, childStatus, usage, &deadline, track);
+	if (stopped != -1) {
+		char commandLine[JOB_TEXT_SIZE];
+		describePipeline(input, commandLine, sizeof(commandLine));
+		stopForegroundJob(pids + stopped, launched - stopped, WEXITSTATUS(*childStatus) - 128, commandLine, 0, &deadline, usage, track, startNanos);
+	}
+	usage->wallNanos = monotonicNanos() - startNanos;
+	deadlineStop(&deadline);
+	return deadline.expired > 0;
+}
+
+
+//hashes a PID into a bucket index for the job table
+static int pidBucket(struct smallshJobTable* jobTable, pid_t pid) {
+	return (unsigned int)pid * 2654435761u & (jobTable->bucketCount - 1);
+}
+
+
+/*	FUNCTION: jobTableInit
+sets up an empty job table and its epoll set. when the shell is interactive stdin goes into the epoll set too (with a NULL data pointer 
+so it can be told apart from the pidfds), which is what lets waitForInput() sleep on the keyboard and the background jobs at the same time
+*/
+void jobTableInit(struct smallshJobTable* jobTable, int interactive) {
+
+	jobTable->jobCount = 0;
+	jobTable->jobCapacity = INITIAL_JOB_SLOTS;
+	jobTable->jobs = malloc(sizeof(struct smallshJob*) * jobTable->jobCapacity);
+	jobTable->bucketCount = INITIAL_PID_BUCKETS;
+	jobTable->buckets = calloc(jobTable->bucketCount, sizeof(struct smallshProcess*));
+	jobTable->processCount = 0;
+	jobTable->unwatchedCount = 0;
+	jobTable->interactive = interactive;
+	jobTable->promptShowing = 0;
+	jobTable->nextJobId = 1;
+
+	jobTable->epollFD = epoll_create1(EPOLL_CLOEXEC);
+	if (jobTable->epollFD == -1) {
+		perror("epoll_create1()");
+		exit(1);
+	}
+
+	if (interactive) {
+		struct epoll_event event = {0};
+		event.events = EPOLLIN;
+		event.data.ptr = NULL;
+		if (epoll_ctl(jobTable->epollFD, EPOLL_CTL_ADD, STDIN_FILENO, &event) == -1) {
+			jobTable->interactive = 0;
+		}
+	}
+}
+
+
+//finds the unreaped background process with the given PID, or NULL if there isn't one
+struct smallshProcess* findProcess(struct smallshJobTable* jobTable, pid_t pid) {
+	struct smallshProcess* process = jobTable->buckets[pidBucket(jobTable, pid)];
+	while (process != NULL && process->pid != pid) {
+		process = process->hashNext;
+	}
+	return process;
+}
+
+
+//doubles the number of buckets in the PID hash and moves every process over to its new bucket
+static void growPidHash(struct smallshJobTable* jobTable) {
+
+	struct smallshProcess** oldBuckets = jobTable->buckets;
+	int oldCount = jobTable->bucketCount;
+
+	jobTable->bucketCount *= 2;
+	jobTable->buckets = calloc(jobTable->bucketCount, sizeof(struct smallshProcess*));
+
+	for (int i = 0; i < oldCount; i++) {
+		struct smallshProcess* process = oldBuckets[i];
+		while (process != NULL) {
+			struct smallshProcess* next = process->hashNext;
+			int bucket = pidBucket(jobTable, process->pid);
+			process->hashNext = jobTable->buckets[bucket];
+			jobTable->buckets[bucket] = process;
+			process = next;
+		}
+	}
+	free(oldBuckets);
+}
+
+
+/*	FUNCTION: addJob
+puts the processes from one launched line into the job table as a new job. each process gets a pidfd which is added to the epoll set 
+with a pointer back to the process, so when it fires we already know exactly which process finished without looking anything up.
+PIDs of -1 (stages that never launched) are left out
+*/
+struct smallshJob* addJob(struct smallshJobTable* jobTable, pid_t* pids, int pidCount, const char* commandLine) {
+
+	int procCount = 0;
+	for (int i = 0; i < pidCount; i++) {
+		if (pids[i] != -1) {
+			procCount++;
+		}
+	}
+	if (procCount == 0) {
+		return NULL;
+	}
+
+	struct smallshJob* job = malloc(sizeof(struct smallshJob) + (sizeof(struct smallshProcess) * procCount));
+	job->id = jobTable->nextJobId++;
+	job->procCount = procCount;
+	job->liveCount = procCount;
+	job->commandLine = strndup(commandLine, strcspn(commandLine, "\n"));
+	job->placement = NULL;
+	job->startNanos = monotonicNanos();
+	job->traceTrack = 0;
+	job->deadline.timerFD = -1;
+	job->deadline.expired = 0;
+	job->group = 0;
+	job->stopped = 0;
+	memset(&job->usage, 0, sizeof(struct smallshUsage));
+
+	if (jobTable->jobCount == jobTable->jobCapacity) {
+		jobTable->jobCapacity *= 2;
+		jobTable->jobs = realloc(jobTable->jobs, sizeof(struct smallshJob*) * jobTable->jobCapacity);
+	}
+	jobTable->jobs[jobTable->jobCount] = job;
+	jobTable->jobCount++;
+
+	for (int i = 0, proc = 0; i < pidCount; i++) {
+		if (pids[i] == -1) {
+			continue;
+		}
+		struct smallshProcess* process = &job->procs[proc++];
+		process->pid = pids[i];
+		process->status = 0;
+		process->done = 0;
+		process->job = job;
+
+		if (jobTable->processCount >= jobTable->bucketCount) {
+			growPidHash(jobTable);
+		}
+		int bucket = pidBucket(jobTable, process->pid);
+		process->hashNext = jobTable->buckets[bucket];
+		jobTable->buckets[bucket] = process;
+		jobTable->processCount++;
+
+		//pidfds are always close-on-exec so none of these leak into the children we launch later
+		process->pidfd = pidfd_open(process->pid, 0);
+		if (process->pidfd != -1) {
+			struct epoll_event event = {0};
+			event.events = EPOLLIN;
+			event.data.ptr = process;
+			if (epoll_ctl(jobTable->epollFD, EPOLL_CTL_ADD, process->pidfd, &event) == -1) {
+				close(process->pidfd);
+				process->pidfd = -1;
+			}
+		}
+		if (process->pidfd == -1) {
+			jobTable->unwatchedCount++;
+		}
+	}
+
+	return job;
+}
+
+
+/*	FUNCTION: reportJob
+prints how a finished background job ended. a pipeline job is reported by its last stage, same as its status would be in the foreground, 
+and a job that was signaled because it ran out of time says so. 
+with 'set -o bgusage' on, what the job cost gets printed under it
+*/
+static void reportJob(struct smallshJobTable* jobTable, struct smallshJob* job) {
+
+	struct smallshProcess* last = &job->procs[job->procCount - 1];
+
+	//if the prompt is sitting there waiting for input we're in the middle of its line, so move down one first
+	if (jobTable->promptShowing) {
+		printf("\n");
+		jobTable->promptShowing = 0;
+	}
+
+	const char* timedOut = (job->deadline.expired > 0) ? " after running out of time" : "";
+	if (WIFEXITED(last->status)) {
+		printf("Background process %d exited with status: %d%s\n", last->pid, WEXITSTATUS(last->status), timedOut);
+	}
+	else {
+		printf("Background process %d exited abnormally due to signal: %d%s\n", last->pid, WTERMSIG(last->status), timedOut);
+	}
+	if (reportBackgroundUsage) {
+		printf("  ");
+		printUsage(stdout, &job->usage);
+	}
+}
+
+
+//takes a finished job out of the job table and frees it, the processes should already be out of the PID hash
+void removeJob(struct smallshJobTable* jobTable, struct smallshJob* job) {
+
+	for (int i = 0; i < jobTable->jobCount; i++) {
+		if (jobTable->jobs[i] == job) {
+			memmove(&jobTable->jobs[i], &jobTable->jobs[i + 1], sizeof(struct smallshJob*) * (jobTable->jobCount - i - 1));
+			jobTable->jobCount--;
+			break;
+		}
+	}
+	if (jobTable->jobCount == 0) {
+		jobTable->nextJobId = 1;
+	}
+
+	deadlineStop(&job->deadline);
+	free(job->commandLine);
+	free(job->placement);
+	free(job);
+}
+
+
+//takes a process out of the job table's PID hash and closes its pidfd, which also takes it out of the epoll set. that's once it's been 
+//reaped, or when 'fg' is about to wait for it itself
+void unwatchProcess(struct smallshJobTable* jobTable, struct smallshProcess* process) {
+
+	if (process->pidfd != -1) {
+		close(process->pidfd);
+		process->pidfd = -1;
+	}
+	else {
+		jobTable->unwatchedCount--;
+	}
+
+	struct smallshProcess** link = &jobTable->buckets[pidBucket(jobTable, process->pid)];
+	while (*link != process) {
+		link = &(*link)->hashNext;
+	}
+	*link = process->hashNext;
+	jobTable->processCount--;
+}
+
+
+/*	FUNCTION: reapProcess
+collects the exit status of one background process that we already know is finished (or, with WNOHANG, might be). it comes out of the 
+job table (see unwatchProcess()), what it used gets added to its job's usage, and if it was the last live process in its job the job is 
+reported and removed. returns 1 if the process was reaped, 0 if it was still running. the process struct might be free'd by the time 
+this returns, so if the caller wants the status it should pass somewhere to put it
+*/
+static int reapProcess(struct smallshJobTable* jobTable, struct smallshProcess* process, int waitOptions, int* statusOut) {
+
+	struct rusage usage;
+
+	if (wait4(process->pid, &process->status, waitOptions, &usage) <= 0) {
+		return 0;
+	}
+	addRusage(&process->job->usage, &usage);
+	if (statusOut != NULL) {
+		*statusOut = process->status;
+	}
+
+	process->done = 1;
+	unwatchProcess(jobTable, process);
+
+	struct smallshJob* job = process->job;
+	traceEvent("reap", -1, job->traceTrack, process->pid, process->status);
+	job->liveCount--;
+	if (job->liveCount == 0) {
+		job->usage.wallNanos = monotonicNanos() - job->startNanos;
+		traceEvent("job", job->startNanos, job->traceTrack, process->pid, job->procs[job->procCount - 1].status);
+		reportJob(jobTable, job);
+		removeJob(jobTable, job);
+	}
+	return 1;
+}
+
+
+/*	FUNCTION: jobOutputOpen
+hands out an output slot for a new background job and makes the pipe its output will go to, putting the read end in the job table's 
+epoll set for job output. a free slot is used if there is one, otherwise the one whose job finished longest ago. the slot's pids are left for the 
+caller to fill in once the job is launched. returns NULL if every slot belongs to a job that's still running, in which case the job 
+just gets /dev/null like it would without 'set -o joboutput'
+*/
+static struct smallshJobOutput* jobOutputOpen(struct smallshJobTable* jobTable, int* writeFD) {
+
+	if (jobOutputs.epollFD == -1) {
+		jobOutputs.epollFD = epoll_create1(EPOLL_CLOEXEC);
+		struct epoll_event event = {0};
+		event.events = EPOLLIN;
+		event.data.ptr = &jobOutputs;
+		if (jobOutputs.epollFD == -1 || epoll_ctl(jobTable->epollFD, EPOLL_CTL_ADD, jobOutputs.epollFD, &event) == -1) {
+			perror("epoll");
+			if (jobOutputs.epollFD != -1) {
+				close(jobOutputs.epollFD);
+				jobOutputs.epollFD = -1;
+			}
+			return NULL;
+		}
+		for (int i = 0; i < JOB_OUTPUT_SLOTS; i++) {
+			jobOutputs.slots[i].readFD = -1;
+		}
+	}
+
+	struct smallshJobOutput* output = NULL;
+	for (int i = 0; i < JOB_OUTPUT_SLOTS; i++) {
+		struct smallshJobOutput* slot = &jobOutputs.slots[i];
+		if (slot->pids == NULL) {
+			output = slot;
+			break;
+		}
+		if (slot->readFD == -1 && (output == NULL || slot->sequence < output->sequence)) {
+			output = slot;
+		}
+	}
+	if (output == NULL) {
+		fprintf(stderr, "smallsh: the output of %d running jobs is already being kept, this one's goes to /dev/null\n", JOB_OUTPUT_SLOTS);
+		return NULL;
+	}
+
+	int pipeFDs[2];
+	if (pipe2(pipeFDs, O_CLOEXEC) == -1) {
+		perror("pipe2()");
+		return NULL;
+	}
+	fcntl(pipeFDs[0], F_SETFL, O_NONBLOCK);
+	struct epoll_event event = {0};
+	event.events = EPOLLIN;
+	event.data.ptr = output;
+	if (epoll_ctl(jobOutputs.epollFD, EPOLL_CTL_ADD, pipeFDs[0], &event) == -1) {
+		perror("epoll_ctl()");
+		close(pipeFDs[0]);
+		close(pipeFDs[1]);
+		return NULL;
+	}
+
+	free(output->pids);
+	output->pids = NULL;
+	output->pidCount = 0;
+	output->readFD = pipeFDs[0];
+	output->total = 0;
+	output->sequence = jobOutputs.sequence++;
+	*writeFD = pipeFDs[1];
+	return output;
+}
+
+
+//closes a job's output pipe, which also takes it out of the epoll set. what's in the ring stays for 'jobs -o'
+static void jobOutputClose(struct smallshJobOutput* output) {
+	if (output->readFD != -1) {
+		close(output->readFD);
+		output->readFD = -1;
+	}
+}
+
+
+/*	FUNCTION: jobOutputDrain
+reads whatever a job has written to its output pipe into the slot's ring, writing over the oldest bytes once it's full, until the pipe 
+is empty. the reads go straight into the ring, up to its end at a time, so nothing gets copied twice. when the pipe hits end of file 
+every process in the job is done with it and it gets closed
+*/
+static void jobOutputDrain(struct smallshJobOutput* output) {
+
+	while (output->readFD != -1) {
+		if (output->ring == NULL) {
+			output->ring = malloc(JOB_OUTPUT_SIZE);
+			if (output->ring == NULL) {
+				perror("malloc()");
+				exit(1);
+			}
+		}
+		size_t head = output->total % JOB_OUTPUT_SIZE;
+		ssize_t got = read(output->readFD, output->ring + head, JOB_OUTPUT_SIZE - head);
+		if (got > 0) {
+			output->total += got;
+		}
+		else if (got == 0 || (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)) {
+			jobOutputClose(output);
+		}
+		else if (errno != EINTR) {
+			break;
+		}
+	}
+}
+
+
+//drains every job output pipe that has something in it, one epoll_wait() on the job output set says which
+static void jobOutputsDrainReady() {
+
+	struct epoll_event events[MAX_EPOLL_EVENTS];
+	int eventCount;
+
+	do {
+		eventCount = epoll_wait(jobOutputs.epollFD, events, MAX_EPOLL_EVENTS, 0);
+		for (int i = 0; i < eventCount; i++) {
+			jobOutputDrain(events[i].data.ptr);
+		}
+	} while (eventCount == MAX_EPOLL_EVENTS);
+}
+
+
+//finds the output slot of the job that had a process with the given PID, NULL if its output wasn't kept or has been written over since
+static struct smallshJobOutput* findJobOutput(pid_t pid) {
+	for (int i = 0; i < JOB_OUTPUT_SLOTS; i++) {
+		for (int proc = 0; proc < jobOutputs.slots[i].pidCount && jobOutputs.slots[i].pids != NULL; proc++) {
+			if (jobOutputs.slots[i].pids[proc] == pid) {
+				return &jobOutputs.slots[i];
+			}
+		}
+	}
+	return NULL;
+}
+
+
+/*	FUNCTION: waitForeground
+wait4() for a foreground process, but while we're blocked on it nothing else would read the pipes that are being drained as they fill: 
+the one for a '$(...)' the command is running in, and the ones of background jobs whose output is being kept. a command (or a job) that 
+prints more than its pipe holds would then sit blocked on a full pipe for as long as the foreground command runs, or forever if it's the 
+command we're waiting on. time limits would go by unnoticed too, the pipeline's own and the background jobs'. so when there are any of 
+those, the process's pidfd goes in one poll() with them and they get taken care of until the process is done. pids is the process to 
+wait for followed by the rest of its pipeline that hasn't been reaped yet (-1 for stages that didn't launch), which is who gets signaled 
+when the deadline goes off. if there's no pidfd for it we just wait. 
+with job control the wait also comes back when the process stops, with a status WIFSTOPPED() is true for and the process left unreaped. 
+a pidfd doesn't say anything about that, so the job control signalfd goes in the poll() too and says when to check
+*/
+pid_t waitForeground(pid_t* pids, int count, int* status, struct rusage* usage, struct smallshDeadline* deadline) {
+
+	int options = jobControl.enabled ? WUNTRACED : 0;
+
+	if (activeCapture != NULL || jobOutputs.epollFD != -1 || deadline->timerFD != -1 || jobDeadlineFD != -1) {
+		int pidfd = pidfd_open(pids[0], 0);
+		//SIGCHLD for a stop that already happened (a later stage of a pipeline that stopped along with the one before it) might have been 
+		//read off the signalfd already, so that gets checked for before sleeping
+		pid_t waited = 0;
+		if (pidfd != -1 && jobControl.enabled && (waited = wait4(pids[0], status, WNOHANG | WUNTRACED, usage)) != 0) {
+			close(pidfd);
+			return waited;
+		}
+		if (pidfd != -1) {
+			struct pollfd fds[6] = {
+				{ pidfd, POLLIN, 0 },
+				{ (activeCapture != NULL) ? activeCapture->readFD : -1, POLLIN, 0 },
+				{ jobOutputs.epollFD, POLLIN, 0 },
+				{ deadline->timerFD, POLLIN, 0 },
+				{ jobDeadlineFD, POLLIN, 0 },
+				{ jobControl.enabled ? jobControl.signalFD : -1, POLLIN, 0 },
+			};
+			for (;;) {
+				//a signal that cut the poll() short leaves revents as they were, so nothing gets looked at until poll() has filled them in
+				if (poll(fds, 6, -1) == -1) {
+					if (errno == EINTR) {
+						continue;
+					}
+					break;
+				}
+				if ((fds[1].revents & (POLLIN | POLLHUP)) && captureDrain(activeCapture)) {
+					fds[1].fd = -1;
+				}
+				if (fds[2].revents & POLLIN) {
+					jobOutputsDrainReady();
+				}
+				if (fds[3].revents & POLLIN) {
+					//a pipeline with a process group of its own gets signaled as a group like coreutils' timeout does, so whatever its 
+					//processes started (a 'sh -c' and its children) goes too. without one only the stages themselves can be signaled
+					int signal = deadlineExpired(deadline);
+					pid_t group = (signal != 0) ? getpgid(pids[0]) : -1;
+					if (group > 0 && group != getpgrp()) {
+						killpg(group, signal);
+						killpg(group, SIGCONT);
+					}
+					else {
+						for (int i = 0; i < count && signal != 0; i++) {
+							if (pids[i] != -1) {
+								kill(pids[i], signal);
+								kill(pids[i], SIGCONT);
+							}
+						}
+					}
+				}
+				if (fds[4].revents & POLLIN) {
+					jobDeadlinesExpired();
+				}
+				//the SIGCHLD could be about a background job too, which gets looked at before the next prompt since it's been read now
+				if (fds[5].revents & POLLIN) {
+					jobControlDrain();
+					jobControl.stopsPending = 1;
+					if ((waited = wait4(pids[0], status, WNOHANG | WUNTRACED, usage)) != 0) {
+						close(pidfd);
+						return waited;
+					}
+				}
+				if (fds[0].revents & POLLIN) {
+					break;
+				}
+			}
+			close(pidfd);
+		}
+	}
+	return wait4(pids[0], status, options, usage);
+}
+
+
+/*	FUNCTION: callExecBackground
+this function is almost identical to our foreground exec function above but doesn't wait on the pipeline, it returns foreground to 
+smallsh and leaves the new children running in the background. the pipeline becomes a job in the job table, which watches it from 
+then on and reports it when it's done. returns the PID of the pipeline's last process for '$!', or -1 if nothing got launched
+*/
+pid_t callExecBackground(struct smallshCommand* input, struct smallshJobTable* jobTable, struct sigaction sa) {
+
+	pid_t pids[input->stageCount];
+	int statuses[input->stageCount];
+	struct smallshPlacement placements[input->stageCount];
+	int outputFD = -1;
+	struct smallshJobOutput* output = keepJobOutput ? jobOutputOpen(jobTable, &outputFD) : NULL;
+	int launched = launchPipeline(input, 1, jobControl.enabled, outputFD, pids, statuses, placements, sa);
+
+	struct smallshJob* job = addJob(jobTable, pids, launched, input->fullInput);
+	//the children have their copies of the write end now, once they've all closed theirs the pipe reads as end of file
+	if (outputFD != -1) {
+		close(outputFD);
+	}
+	if (output != NULL && job == NULL) {
+		jobOutputClose(output);
+		free(output->pids);
+		output->pids = NULL;
+	}
+	else if (output != NULL) {
+		output->pidCount = job->procCount;
+		output->pids = malloc(sizeof(pid_t) * job->procCount);
+		for (int i = 0; i < job->procCount; i++) {
+			output->pids[i] = job->procs[i].pid;
+		}
+	}
+	if (job != NULL) {
+		job->traceTrack = traceLastTrack();
+		job->group = jobControl.enabled ? job->procs[0].pid : 0;
+		jobDeadlineStart(jobTable, job, (input->timeout != NULL) ? input->timeout : &defaultTimeout);
+		char description[PLACEMENT_DESCRIPTION_SIZE];
+		describePlacement(placements, launched, description, sizeof(description));
+		if (description[0] != '\0') {
+			job->placement = strdup(description);
+		}
+		printf("Background process started with PID: %d\n", job->procs[job->procCount - 1].pid);
+		return job->procs[job->procCount - 1].pid;
+	}
+	return -1;
+}
+
+
+/*	FUNCTION: smallshJobs
+built-in that lists every background job that hasn't finished yet, whether it's running or stopped and the PID of each of its processes. 'jobs -l' adds a column 
+showing the CPUs and nice value each job was placed with, or '-' for jobs that run wherever the shell does. 'jobs -o PID' prints what 
+the job with that process has printed so far (or in all, if it's done) when 'set -o joboutput' was on when it started
+*/
+static int smallshJobs(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	if (inputCommand->argCount > 1 && strcmp(inputCommand->arguments[1], "-o") == 0) {
+		char* end = NULL;
+		long pid = (inputCommand->argCount == 3) ? strtol(inputCommand->arguments[2], &end, 10) : 0;
+		if (end == NULL || end == inputCommand->arguments[2] || *end != '\0') {
+			fprintf(stderr, "usage: jobs -o PID\n");
+			return 2;
+		}
+		struct smallshJobOutput* output = findJobOutput(pid);
+		if (output == NULL) {
+			fprintf(stderr, "jobs: no output was kept for %ld, see 'set -o joboutput'\n", pid);
+			return 1;
+		}
+		//pick up anything the job wrote since the last time the epoll set was checked
+		jobOutputDrain(output);
+		fflush(stdout);
+		size_t head = output->total % JOB_OUTPUT_SIZE;
+		if (output->total > JOB_OUTPUT_SIZE) {
+			fprintf(stderr, "jobs: the first %llu bytes of output were dropped\n", output->total - JOB_OUTPUT_SIZE);
+			fwrite(output->ring + head, 1, JOB_OUTPUT_SIZE - head, stdout);
+		}
+		fwrite(output->ring, 1, (output->total > JOB_OUTPUT_SIZE) ? head : output->total, stdout);
+		return 0;
+	}
+
+	int showPlacement = (inputCommand->argCount > 1 && strcmp(inputCommand->arguments[1], "-l") == 0);
+
+	for (int i = 0; i < context->jobTable->jobCount; i++) {
+		struct smallshJob* job = context->jobTable->jobs[i];
+		printf("[%d] %s   ", job->id, job->stopped ? "Stopped" : "Running");
+		for (int proc = 0; proc < job->procCount; proc++) {
+			if (!job->procs[proc].done) {
+				printf("%d ", job->procs[proc].pid);
+			}
+		}
+		if (showPlacement) {
+			printf("  %-16s", job->placement != NULL ? job->placement : "-");
+		}
+		printf("  %s\n", job->commandLine);
+	}
+	return BUILTIN_KEEP_STATUS;
+}
+
+
+/*	FUNCTION: smallshWait
+built-in that blocks until background processes finish. with no arguments it waits for every job, otherwise just for the PIDs given. 
+it sleeps in poll() on the pidfds of the processes it's waiting for, so nothing wakes up until one of them actually exits. the status of 
+the last PID named becomes the status that 'status' reports, like the shell's $? would after a wait. a job that's stopped (or stops 
+while we wait) would never finish with nothing left to continue it, so like sh's wait we stop waiting for it and its status is 128 plus 
+the signal that stopped it
+*/
+static int smallshWait(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	int targetCount = (inputCommand->argCount > 1) ? inputCommand->argCount - 1 : context->jobTable->processCount;
+	struct smallshProcess* targets[targetCount + 1];
+	int found = 0;
+	int lastNamed = -1; //where the last PID named ended up in targets, -1 if it isn't a child of ours (or no PIDs were named)
+
+	if (inputCommand->argCount > 1) {
+		for (int i = 1; i < inputCommand->argCount; i++) {
+			pid_t pid = atoi(inputCommand->arguments[i]);
+			struct smallshProcess* process = findProcess(context->jobTable, pid);
+			if (process == NULL) {
+				fprintf(stderr, "wait: pid %s is not a child of this shell\n", inputCommand->arguments[i]);
+				context->childStatus = W_EXITCODE(127, 0);
+				continue;
+			}
+			if (i == inputCommand->argCount - 1) {
+				lastNamed = found;
+			}
+			targets[found++] = process;
+		}
+	}
+	else {
+		for (int i = 0; i < context->jobTable->jobCount; i++) {
+			for (int proc = 0; proc < context->jobTable->jobs[i]->procCount; proc++) {
+				if (!context->jobTable->jobs[i]->procs[proc].done) {
+					targets[found++] = &context->jobTable->jobs[i]->procs[proc];
+				}
+			}
+		}
+	}
+
+	//the processes get reaped (and their jobs possibly freed) as they finish, so grab everything we need out of them now
+	pid_t targetPids[found + 1];
+	struct pollfd pollFDs[found + 3];
+	for (int i = 0; i < found; i++) {
+		targetPids[i] = targets[i]->pid;
+		pollFDs[i].fd = targets[i]->pidfd;
+		pollFDs[i].events = POLLIN;
+		pollFDs[i].revents = 0;
+	}
+
+	//a stop that was noticed while a foreground command ran hasn't been looked at yet
+	if (jobControl.stopsPending) {
+		jobStopsCheck(context->jobTable);
+	}
+
+	int remaining = found;
+	while (remaining > 0) {
+		for (int i = 0; i < found; i++) {
+			if (targetPids[i] == 0) {
+				continue;
+			}
+			//the process is looked up again every time around instead of trusting the pidfd number saved before, since if it got reaped 
+			//somewhere else that descriptor was closed and could belong to something else by now. one that's gone took its status with it, 
+			//so it gets the same 127 as a PID that was never ours
+			int status = 0;
+			struct smallshProcess* process = findProcess(context->jobTable, targetPids[i]);
+			if (process == NULL) {
+				status = W_EXITCODE(127, 0);
+			}
+			else if (pollFDs[i].revents == 0 && process->job->stopped) {
+				status = W_EXITCODE(128 + process->job->stopped, 0);
+			}
+			//a process without a pidfd can't be slept on with poll(), so we just block in waitpid() on it instead
+			else if (process->pidfd == -1 || pollFDs[i].revents != 0) {
+				reapProcess(context->jobTable, process, 0, &status);
+			}
+			else {
+				pollFDs[i].fd = process->pidfd;
+				continue;
+			}
+			if (i == lastNamed) {
+				context->childStatus = status;
+			}
+			pollFDs[i].fd = -1;
+			pollFDs[i].revents = 0;
+			targetPids[i] = 0;
+			remaining--;
+		}
+		//jobs whose output is being kept would stop once their pipe filled up if it wasn't read while we wait, and the jobs we're waiting
+		//on might have time limits. with job control the SIGCHLD signalfd says when one of them stops
+		pollFDs[found].fd = jobOutputs.epollFD;
+		pollFDs[found].events = POLLIN;
+		pollFDs[found].revents = 0;
+		pollFDs[found + 1].fd = jobDeadlineFD;
+		pollFDs[found + 1].events = POLLIN;
+		pollFDs[found + 1].revents = 0;
+		pollFDs[found + 2].fd = jobControl.enabled ? jobControl.signalFD : -1;
+		pollFDs[found + 2].events = POLLIN;
+		pollFDs[found + 2].revents = 0;
+		if (remaining > 0 && poll(pollFDs, found + 3, -1) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("poll()");
+			break;
+		}
+		if (pollFDs[found].revents & POLLIN) {
+			jobOutputsDrainReady();
+		}
+		if (pollFDs[found + 1].revents & POLLIN) {
+			jobDeadlinesExpired();
+		}
+		if (pollFDs[found + 2].revents & POLLIN) {
+			jobStopsCheck(context->jobTable);
+		}
+	}
+	return BUILTIN_KEEP_STATUS;
+}
+
+
+/*	FUNCTION: readAllFD
+reads everything from a file descriptor into one malloc'd, null terminated buffer, this is how 'parallel' gets its argument lines
+*/
+static char* readAllFD(int fd, size_t* lengthOut) {
+
+	size_t capacity = INPUT_BLOCK_SIZE;
+	size_t length = 0;
+	char* buffer = malloc(capacity);
+	ssize_t bytesRead;
+
+	while ((bytesRead = read(fd, buffer + length, capacity - length - 1)) != 0) {
+		if (bytesRead == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		length += bytesRead;
+		if (capacity - length < INPUT_BLOCK_SIZE / 2) {
+			capacity *= 2;
+			buffer = realloc(buffer, capacity);
+		}
+	}
+
+	buffer[length] = '\0';
+	*lengthOut = length;
+	return buffer;
+}
+
+
+/*	FUNCTION: launchParallelTask
+builds the command for one task by putting its argument line in place of every '{}' in the template (or on the end if the template 
+doesn't have one) and launches it through launchPipeline(), just like a foreground command typed at the prompt, so it gets the same 
+redirections, path cache and launcher. the command is built in the scratch arena, which can be reset as soon as this returns
+*/
+static void launchParallelTask(struct smallshParallelTask* task, char** template, int templateCount, int stdinNull, struct smallshArena* arena, struct sigaction sa) {
+
+	struct smallshCommand* command = newCommandStruct(arena);
+	int substituted = 0;
+	size_t lineLen = strlen(task->argLine);
+
+	for (int i = 0; i < templateCount; i++) {
+		char* placeholder = strstr(template[i], PARALLEL_PLACEHOLDER);
+		if (placeholder == NULL) {
+			addArgument(command, template[i], arena);
+			continue;
+		}
+
+		//count the placeholders so the substituted argument can be allocated once at its final size
+		int placeholders = 0;
+		for (char* found = placeholder; found != NULL; found = strstr(found + strlen(PARALLEL_PLACEHOLDER), PARALLEL_PLACEHOLDER)) {
+			placeholders++;
+		}
+		char* argument = arenaAlloc(arena, strlen(template[i]) + (placeholders * lineLen) + 1);
+		char* out = argument;
+		char* in = template[i];
+		while (placeholder != NULL) {
+			memcpy(out, in, placeholder - in);
+			out += placeholder - in;
+			memcpy(out, task->argLine, lineLen);
+			out += lineLen;
+			in = placeholder + strlen(PARALLEL_PLACEHOLDER);
+			placeholder = strstr(in, PARALLEL_PLACEHOLDER);
+		}
+		strcpy(out, in);
+		addArgument(command, argument, arena);
+		substituted = 1;
+	}
+	if (!substituted) {
+		addArgument(command, task->argLine, arena);
+	}
+
+	//when the argument lines came from stdin the tasks shouldn't be able to read (and steal) the rest of them
+	if (stdinNull) {
+		addRedirect(command, 0, REDIRECT_INPUT, "/dev/null", arena);
+	}
+
+	//the tasks stay in the shell's process group instead of getting one each, so a ^C reaches every one of them at once
+	int failStatus = 0;
+	task->startNanos = monotonicNanos();
+	launchPipeline(command, 0, 0, -1, &task->pid, &failStatus, NULL, sa);
+	task->pidfd = -1;
+	if (task->pid == -1) {
+		task->status = failStatus;
+		task->endNanos = task->startNanos;
+	}
+	else {
+		task->pidfd = pidfd_open(task->pid, 0);
+	}
+}
+
+
+/*	FUNCTION: smallshParallel
+built-in parallel command, works like 'xargs -P': 'parallel [-j N] [-a file] [-q] command args...' reads argument lines from the file 
+given with -a or from stdin (which '<' redirects like it does for any builtin, or a pipeline in front of parallel feeds) and runs the command template once per line, keeping exactly N tasks running at a time. 
+N defaults to the number of online CPUs. a slot is refilled the moment one of the running tasks is reaped, and we find out which one that 
+is by sleeping in poll() on the pidfds of the running tasks, so there's no polling or sleeping in a loop. when everything is done each 
+task's wall time is printed to stderr (unless -q) followed by the overall throughput. the tasks are reaped with wait4() and what they 
+cost all together is what 'status -v' shows afterwards. the status is the number of tasks that failed
+*/
+static int smallshParallel(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	long slots = sysconf(_SC_NPROCESSORS_ONLN);
+	char* argFile = NULL;
+	int quiet = 0;
+	int arg = 1;
+
+	//options come first, everything after them is the command template
+	for (; arg < inputCommand->argCount && inputCommand->arguments[arg][0] == '-'; arg++) {
+		if (strcmp(inputCommand->arguments[arg], "-j") == 0 && arg + 1 < inputCommand->argCount) {
+			//anything that isn't all digits gets the usage message below instead of quietly turning into 0
+			char* count = inputCommand->arguments[++arg];
+			char* end;
+			slots = strtol(count, &end, 10);
+			if (end == count || *end != '\0') {
+				slots = 0;
+			}
+		}
+		else if (strcmp(inputCommand->arguments[arg], "-a") == 0 && arg + 1 < inputCommand->argCount) {
+			argFile = inputCommand->arguments[++arg];
+		}
+		else if (strcmp(inputCommand->arguments[arg], "-q") == 0) {
+			quiet = 1;
+		}
+		else if (strcmp(inputCommand->arguments[arg], "--") == 0) {
+			arg++;
+			break;
+		}
+		else {
+			break;
+		}
+	}
+	if (arg >= inputCommand->argCount || slots < 1) {
+		fprintf(stderr, "usage: parallel [-j N] [-a file] [-q] command [args...]\n");
+		return 2;
+	}
+
+	//read every argument line up front, they get split in place and each task just points at its line
+	int argFD = STDIN_FILENO;
+	if (argFile != NULL) {
+		argFD = open(argFile, O_RDONLY | O_CLOEXEC);
+		if (argFD == -1) {
+			perror("parallel: open()");
+			return 1;
+		}
+	}
+	size_t inputLength;
+	char* lines = readAllFD(argFD, &inputLength);
+	if (argFD != STDIN_FILENO) {
+		close(argFD);
+	}
+
+	int taskCount = 0;
+	int taskCapacity = INITIAL_JOB_SLOTS;
+	struct smallshParallelTask* tasks = malloc(sizeof(struct smallshParallelTask) * taskCapacity);
+	char* saveptr;
+	for (char* line = strtok_r(lines, "\n", &saveptr); line != NULL; line = strtok_r(NULL, "\n", &saveptr)) {
+		if (taskCount == taskCapacity) {
+			taskCapacity *= 2;
+			tasks = realloc(tasks, sizeof(struct smallshParallelTask) * taskCapacity);
+		}
+		tasks[taskCount].argLine = line;
+		taskCount++;
+	}
+
+	if (slots > taskCount) {
+		slots = (taskCount > 0) ? taskCount : 1;
+	}
+
+	struct smallshArena taskArena = {0};
+	//these are sized by -j (no more than the number of tasks), which is too much to trust to the stack
+	struct pollfd* running = malloc(sizeof(struct pollfd) * (slots + 1)); //pidfds of the running tasks, packed at the front, and after them the SIGCHLD signalfd
+	int* runningTask = malloc(sizeof(int) * slots); //which task each of those belongs to
+	int runningCount = 0;
+	int nextTask = 0;
+	int failed = 0;
+	int childFD = -1; //where SIGCHLD gets read from once a task without a pidfd comes up, -1 until then
+	int ownChildFD = 0; //a bool that's true when childFD is one we made (there's no job control one), it gets closed at the end
+	sigset_t childSignals;
+	sigset_t oldMask;
+	struct rusage taskUsage;
+	long long startNanos = monotonicNanos();
+	memset(&context->lastUsage, 0, sizeof(struct smallshUsage));
+
+	while (nextTask < taskCount || runningCount > 0) {
+
+		//top up every free slot
+		while (runningCount < slots && nextTask < taskCount) {
+			struct smallshParallelTask* task = &tasks[nextTask];
+			launchParallelTask(task, &inputCommand->arguments[arg], inputCommand->argCount - arg, argFile == NULL, &taskArena, context->sa);
+			arenaReset(&taskArena);
+			if (task->pid != -1) {
+				running[runningCount].fd = task->pidfd;
+				running[runningCount].events = POLLIN;
+				running[runningCount].revents = 0;
+				runningTask[runningCount] = nextTask;
+				runningCount++;
+			}
+			nextTask++;
+		}
+		if (runningCount == 0) {
+			continue;
+		}
+
+		//sleep until a task exits. a task we couldn't get a pidfd for can't be slept on by itself, but SIGCHLD can once it's blocked and 
+		//read from a signalfd: the job control one, or one of our own that lasts until parallel is done. it could have exited before 
+		//SIGCHLD was blocked, so the first time around every task just gets checked
+		int unwatched = 0;
+		for (int i = 0; i < runningCount; i++) {
+			unwatched |= (running[i].fd == -1);
+		}
+		int timeout = -1;
+		if (unwatched && childFD == -1 && !ownChildFD) {
+			childFD = jobControl.signalFD;
+			if (childFD == -1) {
+				sigemptyset(&childSignals);
+				sigaddset(&childSignals, SIGCHLD);
+				sigprocmask(SIG_BLOCK, &childSignals, &oldMask);
+				childFD = signalfd(-1, &childSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+				ownChildFD = 1;
+			}
+			timeout = 0;
+		}
+		//without a signalfd either, there's nothing to do but block in wait4() on the unwatched tasks one at a time
+		if (unwatched && childFD == -1) {
+			timeout = 0;
+		}
+		running[runningCount].fd = unwatched ? childFD : -1;
+		running[runningCount].events = POLLIN;
+		running[runningCount].revents = 0;
+		if (poll(running, runningCount + 1, timeout) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("parallel: poll()");
+			break;
+		}
+		if (running[runningCount].revents & POLLIN) {
+			struct signalfd_siginfo signals[16];
+			while (read(childFD, signals, sizeof(signals)) > 0);
+			//the SIGCHLD could be about a background job stopping too, which gets looked at before the next prompt since it's been read now
+			if (!ownChildFD) {
+				jobControl.stopsPending = 1;
+			}
+		}
 
+		for (int i = 0; i < runningCount; i++) {
+			struct smallshParallelTask* task = &tasks[runningTask[i]];
+			int options = (running[i].fd == -1 && childFD == -1) ? 0 : WNOHANG;
+			if ((running[i].fd != -1 && running[i].revents == 0) || wait4(task->pid, &task->status, options, &taskUsage) <= 0) {
+				continue;
+			}
+			task->endNanos = monotonicNanos();
+			addRusage(&context->lastUsage, &taskUsage);
+			if (running[i].fd != -1) {
+				close(running[i].fd);
+			}
+			//move the last running task into this slot and look at the slot again
+			runningCount--;
+			running[i] = running[runningCount];
+			runningTask[i] = runningTask[runningCount];
+			i--;
+		}
+	}
+	if (ownChildFD) {
+		if (childFD != -1) {
+			close(childFD);
+		}
+		sigprocmask(SIG_SETMASK, &oldMask, NULL);
+	}
 
-//this function clears any allocated memory within a command struct
-//the struct itself must be free'd seperately
-void freeCommandStructMembers(struct smallshCommand* input) {
-	if (input != NULL) {
-		free(input->fullInput);
-		free(input->command);
-		free(input->inputFile);
-		free(input->outputFile);
-		for (int i = 0; i < input->argCount; i++) {
-			free(input->arguments[i]);
+	long long totalNanos = monotonicNanos() - startNanos;
+	for (int i = 0; i < taskCount; i++) {
+		int taskFailed = !WIFEXITED(tasks[i].status) || WEXITSTATUS(tasks[i].status) != 0;
+		failed += taskFailed;
+		if (!quiet) {
+			fprintf(stderr, "parallel: %8.3fs  %s  %s\n", (tasks[i].endNanos - tasks[i].startNanos) / 1e9, taskFailed ? "FAIL" : "ok  ", tasks[i].argLine);
 		}
 	}
+	fprintf(stderr, "parallel: %d tasks (%d failed) on %ld slots in %.3fs, %.1f tasks/s\n", taskCount, failed, slots, totalNanos / 1e9, (totalNanos > 0) ? taskCount / (totalNanos / 1e9) : 0.0);
+	context->lastUsage.wallNanos = totalNanos;
+
+	free(running);
+	free(runningTask);
+	free(tasks);
+	free(lines);
+	arenaReset(&taskArena);
+	free(taskArena.current);
+	return (failed > PARALLEL_MAX_FAILED) ? PARALLEL_MAX_FAILED : failed;
 }
 
 
-/*	FUNCTION: expandPidVar
-this function takes a c string parameter and, if the string contains an instance of the substring "$$" it will return a pointer 
-to a newly allocated c string with the "$$" substring expanded into the process ID of the calling process. if the input string 
-has no instance of the substring, the function will return the input string and NOT allocate any memory. the function must be 
-called an additional time for each instance of the substring.
-
-its not very efficient because it allocates and frees memory for every instance of '$$' but it works and doesnt leak! Probably could 
-be better if all the instances were counted first and a single new block of memory was created once for the whole line, also getpid() 
-could be called only once in the calling function and passed to this function instead of calling it for every loop...
+/*	FUNCTION: smallshStatus
+built-in status command, prints how the last foreground command ended, and whether it was because it ran out of time. 'status -v' also 
+prints what it cost to run
 */
-char* expandPidVar(char* stringIn) {
+static int smallshStatus(struct smallshCommand* inputCommand, struct smallshContext* context) {
 
-	char* substring = strstr(stringIn, PID_VAR_EXPANSION);
-
-	if (substring == NULL) {
-		return stringIn;
+	const char* timedOut = context->timedOut ? " after running out of time" : "";
+	if (WIFEXITED(context->childStatus)) {
+		printf("Child exit status: %d%s\n", WEXITSTATUS(context->childStatus), timedOut);
+	}
+	else {
+		printf("Child exited abnormally due to signal: %d%s\n", WTERMSIG(context->childStatus), timedOut);
+	}
+	if (inputCommand->argCount > 1 && strcmp(inputCommand->arguments[1], "-v") == 0) {
+		printf("  ");
+		printUsage(stdout, &context->lastUsage);
 	}
+	return BUILTIN_KEEP_STATUS;
+}
+
 
-	//get our pid
-	int pid = getpid();
-	//find out how many chars our pid int will need when converted to string. snprintf will return the number of characters that need to be allocated in memory for the PID string when we pass NULL as the first arg
-	int pidStringLen = snprintf(NULL, 0, "%d", pid);
-	//allocate memory for our pid string
-	char* pidString = malloc((sizeof(char) * pidStringLen) + 1);
-	//convert our pid int to a string
-	sprintf(pidString, "%d", pid);
+/*	FUNCTION: smallshTime
+built-in time command, 'time command args...' runs the rest of the line (pipeline and all) in the foreground and then prints what it 
+cost to stderr like bash does, plus the max RSS and context switches that wait4() gave us. it shifts 'time' off the front of the 
+arguments so the command struct looks like the line never had it, and puts it back afterwards since a loop or the line cache can run 
+the same struct again
+*/
+static int smallshTime(struct smallshCommand* inputCommand, struct smallshContext* context) {
 
-	//calculate the size of our new string with the first instance of '$$' expanded into the PID, which will be equal to the size of the original string plus the length of the PID string minus the length of "$$"
-	int newStringLen = strlen(stringIn) + pidStringLen - strlen(PID_VAR_EXPANSION);
-	char* newString = malloc((sizeof(char) * newStringLen) + 1);
-	newString[0] = '\0';
+	if (inputCommand->argCount == 1) {
+		fprintf(stderr, "usage: time command [args...]\n");
+		return BUILTIN_KEEP_STATUS;
+	}
 
-	//since substring and stringIn are pointers to the same string in different positions we use pointer arithmetic here to get the position of the first occurence of substring
-	int substringPos = substring - stringIn;
+	inputCommand->arguments++;
+	inputCommand->argCount--;
+	inputCommand->argCapacity--;
+	inputCommand->command = inputCommand->arguments[0];
 
-	//assemble our new string
-	strncat(newString, stringIn, substringPos);
-	strcat(newString, pidString);
-	strcat(newString, substring + strlen(PID_VAR_EXPANSION));
+	context->timedOut = callExecForeground(inputCommand, &context->childStatus, &context->lastUsage, context->sa);
 
-	free(pidString);
+	inputCommand->arguments--;
+	inputCommand->argCount++;
+	inputCommand->argCapacity++;
+	inputCommand->command = inputCommand->arguments[0];
 
-	return newString;
+	fprintf(stderr, "\nreal\t%.3fs\nuser\t%ld.%03lds\nsys\t%ld.%03lds\nmaxrss\t%ld KiB\nctxsw\t%ld voluntary, %ld involuntary\n",
+		context->lastUsage.wallNanos / 1e9,
+		(long)context->lastUsage.userTime.tv_sec, (long)context->lastUsage.userTime.tv_usec / 1000,
+		(long)context->lastUsage.systemTime.tv_sec, (long)context->lastUsage.systemTime.tv_usec / 1000,
+		context->lastUsage.maxRSS, context->lastUsage.voluntarySwitches, context->lastUsage.involuntarySwitches);
+	return BUILTIN_KEEP_STATUS;
 }
 
 
-/*	FUNCTION: smallshGetInput
-this function uses getline() to take user input from the command line. it also calls our '$$' expansion function on that input 
-line before parsing otherwise. the return value will be passed to our command parsing function which will turn it into a command struct
-*/
-char* smallshGetInput() {
-	char* inputLine;
-	char* expandedInputLine;
-	size_t inputLength = 0;
+//the shell options that 'set -o' and 'set +o' turn on and off
+struct smallshOption shellOptions[] = {
+	{ "bgusage", &reportBackgroundUsage, "report what background jobs cost when they finish" },
+	{ "joboutput", &keepJobOutput, "keep the last 64 KiB each background job prints for 'jobs -o PID'" },
+	{ "noglob", &noGlob, "leave '*', '?' and '[...]' as they are instead of matching file names" },
+	{ "fgonly", &foregroundOnlyMode, "ignore '&' and run everything in the foreground, what ^Z does when there's no job control" },
+	{ NULL, NULL, NULL }
+};
 
 
-	if (getline(&inputLine, &inputLength, stdin) != -1) {
-		//call our "$$" substring expansion function on the raw input line, if no instance of the substring is found it will simply return the input line with no extra allocated memory, and we take care of the getline allocated memory in the main shell loop function
-		expandedInputLine = expandPidVar(inputLine);
-		//check equivalency of the raw input against the same input run through the substring expansion function, if they're the same, no substring was found and we can move on
-		//if they're different, we found and substituted and instance of the substring and we must call it consecutive times to find all instances of the substring if there are more than one
-		//we use the temp pointer here to free up the memory we allocated for each successful call of the substring expansion function.
-		while (strcmp(inputLine, expandedInputLine) != 0) {
-			char* temp = inputLine;
-			inputLine = expandedInputLine;
-			expandedInputLine = expandPidVar(inputLine);
-			free(temp);
-		}
+/*	FUNCTION: smallshSet
+built-in set command, 'set -o name' turns a shell option on and 'set +o name' turns it off. with no arguments it lists the options
+*/
+static int smallshSet(struct smallshCommand* inputCommand, struct smallshContext* context) {
 
-		return inputLine;
+	if (inputCommand->argCount == 1) {
+		for (struct smallshOption* option = shellOptions; option->name != NULL; option++) {
+			printf("%-12s %-4s %s\n", option->name, *option->flag ? "on" : "off", option->description);
+		}
+		return BUILTIN_KEEP_STATUS;
 	}
-	else {
-		fflush(stdout);
-		//clearerr(stdin);
-		return NULL;
+
+	for (int i = 1; i + 1 < inputCommand->argCount; i += 2) {
+		int value;
+		if (strcmp(inputCommand->arguments[i], "-o") == 0) {
+			value = 1;
+		}
+		else if (strcmp(inputCommand->arguments[i], "+o") == 0) {
+			value = 0;
+		}
+		else {
+			break;
+		}
+		struct smallshOption* option = shellOptions;
+		while (option->name != NULL && strcmp(option->name, inputCommand->arguments[i + 1]) != 0) {
+			option++;
+		}
+		if (option->name == NULL) {
+			fprintf(stderr, "set: %s: invalid option name\n", inputCommand->arguments[i + 1]);
+			return BUILTIN_KEEP_STATUS;
+		}
+		*option->flag = value;
+		if (i + 2 >= inputCommand->argCount) {
+			return BUILTIN_KEEP_STATUS;
+		}
 	}
+	fprintf(stderr, "usage: set [-o|+o option]...\n");
+	return BUILTIN_KEEP_STATUS;
 }
 
 
-/*	FUNCTION: smallshParseInput
-this function parses the full command (with '$$' expanded into the PID already) into tokens which are then placed into 
-their corresponding member variables in the command struct and then returns the newly allocated struct which must be free'd later
+/*	FUNCTION: smallshExit
+built-in exit command, sets the exitShell var in the context so the rest of the line is skipped and the main loop stops. 'exit n' also replaces the last status so 
+the shell exits with n
 */
-struct smallshCommand* smallshParseInput(char* inputLine) {
-	
-	if (inputLine != NULL) {
-		//create a copy of the full input line so we can store it before strtok_r manipulates the original, in case we need it for something...
-		char* fullInputLine = malloc((sizeof(char) * strlen(inputLine)) + 1);
-		strcpy(fullInputLine, inputLine);
+static int smallshExit(struct smallshCommand* inputCommand, struct smallshContext* context) {
 
-		char* saveptr;
-		char* token = strtok_r(inputLine, DELIMITERS, &saveptr);
+	context->exitShell = 1;
+	if (inputCommand->argCount > 1) {
+		return atoi(inputCommand->arguments[1]) & 0xff;
+	}
+	return BUILTIN_KEEP_STATUS;
+}
 
-		if (token == NULL) {
-			//not sure if this free() is necessary but i'm pretty sure it would allocate memory for just the newline character if the command line was otherwise blank, with the way i have it setup
-			free(fullInputLine);
-			return NULL;
-		}
 
-		//initialize our new command struct
-		struct smallshCommand* newCommand = malloc(sizeof(struct smallshCommand));
-		newCommand->fullInput = fullInputLine;
-		newCommand->command = NULL;
-		newCommand->inputFile = NULL;
-		newCommand->outputFile = NULL;
-		newCommand->ampersand = 0;
-		newCommand->exitShell = 0;
-		newCommand->argCount = 0;
-		for (int i = 0; i < MAX_ARGUMENTS; i++) {
-			newCommand->arguments[i] = NULL;
-		}
-
-		//the first string token of the input line will be our command, so assign it to our 'command' member variable (ultimately this 'command' member variable is unnecessary because arguments[0] will always be identical, i just didn't realize that until after I had set up a lot of other stuff)
-		newCommand->command = calloc(strlen(token) + 1, sizeof(char));
-		strcpy(newCommand->command, token);
-		//our command also needs to be the first element of our argument array if we're passing the command to an exec() function so also put the first token of the input line into the first index of the argument array
-		newCommand->arguments[newCommand->argCount] = calloc(strlen(token) + 1, sizeof(char));
-		strcpy(newCommand->arguments[newCommand->argCount], token);
-		newCommand->argCount++;
-
-		token = strtok_r(NULL, DELIMITERS, &saveptr);
-
-		while (token != NULL) {
-
-			//if we find < surrounded by spaces we know the next token will be our input file
-			if (strcmp(token, "<") == 0) {
-				token = strtok_r(NULL, DELIMITERS, &saveptr);
-				newCommand->inputFile = calloc(strlen(token) + 1, sizeof(char));
-				strcpy(newCommand->inputFile, token);
-			}
-			//if we find > we know the next token is our output file
-			else if (strcmp(token, ">") == 0) {
-				token = strtok_r(NULL, DELIMITERS, &saveptr);
-				newCommand->outputFile = calloc(strlen(token) + 1, sizeof(char));
-				strcpy(newCommand->outputFile, token);
-			}
-			//otherwise, we'll treat the token as an argument
-			else {
-				newCommand->arguments[newCommand->argCount] = calloc(strlen(token) + 1, sizeof(char));
-				strcpy(newCommand->arguments[newCommand->argCount], token);
-				newCommand->argCount++;
-			}
+//every command the shell runs itself instead of launching a process. the ones marked as having a program are just faster versions of 
+//something in $PATH, so when they're backgrounded the real program gets launched instead. only 'time' handles a whole pipeline
+struct smallshBuiltin builtins[] = {
+	{ "exit", smallshExit, 0, 0 },
+	{ "cd", smallshCD, 0, 0 },
+	{ "status", smallshStatus, 0, 0 },
+	{ "time", smallshTime, 1, 0 },
+	{ "timeout", smallshTimeoutBuiltin, 1, 0 },
+	{ "set", smallshSet, 0, 0 },
+	{ "launcher", smallshLauncher, 0, 0 },
+	{ "placement", smallshPlacementBuiltin, 0, 0 },
+	{ "hash", smallshHash, 0, 0 },
+	{ "parallel", smallshParallel, 0, 0, 1 },
+	{ "jobs", smallshJobs, 0, 0 },
+	{ "wait", smallshWait, 0, 0 },
+	{ "fg", smallshFg, 0, 0 },
+	{ "bg", smallshBg, 0, 0 },
+	{ "kill", smallshKill, 0, 1 },
+	{ "echo", smallshEcho, 0, 1 },
+	{ "printf", smallshPrintf, 0, 1 },
+	{ "test", smallshTest, 0, 1 },
+	{ "[", smallshTest, 0, 1 },
+	{ "true", smallshTrue, 0, 1 },
+	{ "false", smallshFalse, 0, 1 },
+	{ NULL, NULL, 0, 0 }
+};
 
-			token = strtok_r(NULL, DELIMITERS, &saveptr);
-		}
 
-		//check if the last argument is an ampersand, and if the last character on the whole input line is an ampersand to determine if the command should run in background
-		//if it is an ampersand, free the allocated memory for it in the argument array and remove it from the arguments list, and set the 'ampersand' member variable to true
-		if ((newCommand->argCount > 1) && (newCommand->fullInput[strlen(newCommand->fullInput) - 2] == '&')) { //note that the full input line ends with a '\n' so we must subtract 2 instead of 1 to get the last array index
-			if (strcmp(newCommand->arguments[newCommand->argCount - 1], "&") == 0) {
-				newCommand->ampersand = 1;
-				free(newCommand->arguments[newCommand->argCount - 1]);
-				newCommand->arguments[newCommand->argCount - 1] = NULL;
-				newCommand->argCount--;
-			}
+//looks a command name up in the builtin table, returns NULL if the shell doesn't have a builtin by that name
+static struct smallshBuiltin* findBuiltin(const char* name) {
+	for (struct smallshBuiltin* builtin = builtins; builtin->name != NULL; builtin++) {
+		if (strcmp(builtin->name, name) == 0) {
+			return builtin;
 		}
-
-		return newCommand;
-	}
-	else {
-		return NULL;
 	}
+	return NULL;
 }
 
 
-/*	FUNCTION: smallshCD
-pretty self explanatory change directory function. we use the chdir() and pass it either the environment variable for HOME, 
-or whatever the first argument was after 'cd', if there is one
+/*	FUNCTION: redirectBuiltin
+a builtin runs in the shell's own process, so its redirections have to be put on the shell's own descriptors for as long as it runs. 
+the files are opened by openRedirects() just like for a launched command, and the first time each descriptor gets changed the shell's 
+copy is moved out of the way (with close-on-exec so children launched by the builtin don't get it) and remembered in the redirect's 
+savedFD for restoreBuiltin() to put back. returns -1 if a file couldn't be opened, in which case nothing was changed
 */
-void smallshCD(struct smallshCommand* inputCommand) {
-	
-	int chdirStatus;
-	
-	if (inputCommand->argCount == 1) {
-		chdirStatus = chdir(getenv("HOME"));
+static int redirectBuiltin(struct smallshCommand* inputCommand) {
+
+	if (inputCommand->redirects == NULL) {
+		return 0;
 	}
-	else if (inputCommand->argCount > 1) {
-		chdirStatus = chdir(inputCommand->arguments[1]);
+	if (openRedirects(inputCommand) == -1) {
+		return -1;
 	}
-	
-	if (chdirStatus == -1) {
-		perror("chdir");
+
+	//whatever the shell already printed belongs to the old stdout
+	fflush(stdout);
+
+	for (struct smallshRedirect* redirect = inputCommand->redirects; redirect != NULL; redirect = redirect->next) {
+		int alreadySaved = 0;
+		for (struct smallshRedirect* earlier = inputCommand->redirects; earlier != redirect; earlier = earlier->next) {
+			alreadySaved |= (earlier->fd == redirect->fd);
+		}
+		if (!alreadySaved) {
+			redirect->savedFD = fcntl(redirect->fd, F_DUPFD_CLOEXEC, REDIRECT_HIGH_FD);
+		}
+
+		if (redirect->type == REDIRECT_CLOSE) {
+			close(redirect->fd);
+		}
+		else if (redirect->sourceFD != redirect->fd && dup2(redirect->sourceFD, redirect->fd) == -1) {
+			fprintf(stderr, "smallsh: %d: %s\n", redirect->sourceFD, strerror(errno));
+		}
 	}
+	return 0;
 }
 
 
-/*	FUNCTION: callExecForeground
-this function takes our command struct as input and forks off a new process that calls an exec() function which is passed our 
-command structs arguments. the child process created here runs in the foreground and thus smallsh will be blocked until the child is finished
+//puts back the descriptors that redirectBuiltin() moved out of the way, and closes the ones that weren't open before the builtin ran
+static void restoreBuiltin(struct smallshCommand* inputCommand) {
+
+	if (inputCommand->redirects == NULL) {
+		return;
+	}
+
+	fflush(stdout);
+	for (struct smallshRedirect* redirect = inputCommand->redirects; redirect != NULL; redirect = redirect->next) {
+		if (redirect->savedFD == REDIRECT_NOT_SAVED) {
+			continue;
+		}
+		if (redirect->savedFD == -1) {
+			close(redirect->fd);
+		}
+		else {
+			dup2(redirect->savedFD, redirect->fd);
+			close(redirect->savedFD);
+		}
+		redirect->savedFD = REDIRECT_NOT_SAVED;
+	}
+	closeRedirects(inputCommand);
+}
+
+
+/*	FUNCTION: runBuiltin
+runs a builtin in the shell's process with its redirects in place, and keeps the status it returns. 'time' and 'timeout' are the 
+exceptions, their redirects belong to the command they run so they get the command struct untouched
 */
-void callExecForeground(struct smallshCommand* input, int* childStatus, struct sigaction sa) {
-	
-	int inputFD;
-	int outputFD;
-	pid_t newPid = fork();
+static void runBuiltin(struct smallshBuiltin* builtin, struct smallshCommand* inputCommand, struct smallshContext* context) {
 
-	switch(newPid) {
-		case -1:
-			perror("fork()\n");
-			exit(1);
-			break;
-		case 0:
-			//this child process is being run in the foreground so we want SIGINT to stop it, so we change the handler back to SIG_DFL because that will actually be inherited by exec() 
-			sa.sa_handler = SIG_DFL;
-			sigaction(SIGINT, &sa, NULL);
-
-			//check for input file from the command struct. if there is one, open it and redirect stdin to the input file
-			//i'm not sure if the file should be opened in the parent or the child (??), obviously dup2() must be done in the child process, but this way seems to work with the test script and makes it so if it fails the parent doesn't exit
-			if (input->inputFile != NULL) {
-				inputFD = open(input->inputFile, O_RDONLY);
-				if (inputFD == -1) {
-					perror("source open()");
-					exit(1);
-				}
-				int result = dup2(inputFD, 0);
-				if (result == -1) {
-					perror("source dup2()");
-					exit(1);
+	if (!builtin->wholePipeline && redirectBuiltin(inputCommand) == -1) {
+		context->childStatus = W_EXITCODE(1, 0);
+		return;
+	}
 
-				}
-			}
-			//same as above but for an output file
-			if (input->outputFile != NULL) {
-				outputFD = open(input->outputFile, O_WRONLY | O_CREAT | O_TRUNC, 0640);
-				if (outputFD == -1) {
-					perror("target open()");
-					exit(1);
-				}
-				int result = dup2(outputFD, 1);
-				if (result == -1) {
-					perror("target dup2()");
-					exit(1);
-				}
-			}
-			//call exec() using our command struct members
-			execvp(input->arguments[0], input->arguments);
-			perror(input->arguments[0]);
-			exit(2);
-			break;
-		default:
-			//since this child process is being run in the foreground, we want the childStatus to work with our 'status' function and persist to the next command, so the childStatus variable here is passed by reference and exists in the scope of the main loop
-			//alternatively, childStatus could be the return value of this function
-			newPid = waitpid(newPid, childStatus, 0);
-			break;
+	int result = builtin->run(inputCommand, context);
+
+	if (!builtin->wholePipeline) {
+		restoreBuiltin(inputCommand);
+	}
+	if (result != BUILTIN_KEEP_STATUS) {
+		context->childStatus = W_EXITCODE(result & 0xff, 0);
+		context->timedOut = 0;
 	}
 }
 
 
-/*	FUNCTION: callExecBackground
-this function is almost identical to our foreground exec function above but, uses the WNOHANG arugment when it calls waitpid() function 
-to return foreground to smallsh and run the new child process in the background. it stores the background child's PID in an array 
-that exists outside the scope of this function
+/*	FUNCTION: runPipedBuiltin
+runs a pipeline whose last stage is a builtin that reads its stdin, like 'printf "a\nb\n" | parallel echo'. the stages in front of it are 
+launched like a foreground pipeline, except that they stay in the shell's process group like parallel's tasks do, and the last of them 
+writes into a pipe that the builtin gets as its stdin. a '<' on the builtin's own stage still wins over that, same as for a program. 
+they're reaped once the builtin is done, and the builtin's status is the pipeline's like the last stage's always is
 */
-void callExecBackground(struct smallshCommand* input, pid_t* backgroundPids) {
+static void runPipedBuiltin(struct smallshBuiltin* builtin, struct smallshCommand* input, struct smallshContext* context) {
 
-	int status;
-	int inputFD;
-	int outputFD;
-	pid_t newPid = fork();
+	struct smallshCommand* feeder = input;
+	while (feeder->nextStage->nextStage != NULL) {
+		feeder = feeder->nextStage;
+	}
+	struct smallshCommand* lastStage = feeder->nextStage;
 
-	switch (newPid) {
-		case -1:
-			perror("fork()\n");
-			exit(1);
-			break;
-		case 0:
-			//open our input file if there is one, otherwise exit the child with status 0
-			if (input->inputFile != NULL) {
-				inputFD = open(input->inputFile, O_RDONLY);
-				if (inputFD == -1) {
-					perror("source open()");
-					exit(1);
-				}
-				int result = dup2(inputFD, 0);
-				if (result == -1) {
-					perror("source dup2()");
-					exit(1);
-				}
-			}
-			//if the process is run in the background with no input file, we redirect stdin to dev/null
-			else {
-				inputFD = open("/dev/null", O_RDONLY);
-				int result = dup2(inputFD, 0);
-				if (result == -1) {
-					perror("source dup2()");
-					exit(1);
-				}
-			}
-			//open our output file if there is one, otherwise exit the child with status 0
-			if (input->outputFile != NULL) {
-				outputFD = open(input->outputFile, O_WRONLY | O_CREAT | O_TRUNC, 0640);
-				if (outputFD == -1) {
-					perror("target open()");
-					exit(1);
-				}
-				int result = dup2(outputFD, 1);
-				if (result == -1) {
-					perror("target dup2()");
-					exit(1);
-				}
-			}
-			//likewise we redirect stdout to dev/null if there is no output file specified
-			else {
-				outputFD = open("/dev/null", O_WRONLY);
-				int result = dup2(outputFD, 1);
-				if (result == -1) {
-					perror("source dup2()");
-					exit(1);
-				}
-			}
-			execvp(input->arguments[0], input->arguments);
-			perror(input->arguments[0]);
-			exit(2);
-			break;
-		default:
-			printf("Background process started with PID: %d\n", newPid);
-			//put the PID of our new child in our array of background PIDs that will be checked everytime the shell resfreshes the command line
-			for (int i = 0; i < MAX_BACKGROUND_PIDS; i++) {
-				if (backgroundPids[i] == 0) {
-					backgroundPids[i] = newPid;
-					break;
-				}
-			}
-			newPid = waitpid(newPid, &status, WNOHANG);
-			break;
+	int pipeFDs[2];
+	if (pipe2(pipeFDs, O_CLOEXEC) == -1) {
+		perror("pipe2()");
+		context->childStatus = W_EXITCODE(1, 0);
+		return;
+	}
+
+	//the stages in front get the pipe as their stdout the same way a '$(...)' hands its pipe to what it runs, by having it on the shell's 
+	//fd 1 while they launch. the builtin's stage is cut off the pipeline for that long
+	int stageCount = input->stageCount;
+	feeder->nextStage = NULL;
+	input->stageCount--;
+	pid_t pids[input->stageCount];
+	int statuses[input->stageCount];
+	long long startNanos = monotonicNanos();
+	fflush(stdout);
+	int savedStdout = fcntl(1, F_DUPFD_CLOEXEC, REDIRECT_HIGH_FD);
+	dup2(pipeFDs[1], 1);
+	close(pipeFDs[1]);
+	int launched = launchPipeline(input, 0, 0, -1, pids, statuses, NULL, context->sa);
+	int track = traceLastTrack();
+	if (savedStdout != -1) {
+		dup2(savedStdout, 1);
+		close(savedStdout);
+	}
+	else {
+		close(1);
+	}
+	feeder->nextStage = lastStage;
+	input->stageCount = stageCount;
+
+	//once the builtin is done the shell's read end goes away with the restored stdin, so a stage that still has more to write gets SIGPIPE 
+	//instead of waiting on a reader that's gone
+	int savedStdin = fcntl(0, F_DUPFD_CLOEXEC, REDIRECT_HIGH_FD);
+	dup2(pipeFDs[0], 0);
+	close(pipeFDs[0]);
+	runBuiltin(builtin, lastStage, context);
+	if (savedStdin != -1) {
+		dup2(savedStdin, 0);
+		close(savedStdin);
+	}
+	else {
+		close(0);
+	}
+
+	int feederStatus;
+	struct smallshUsage usage = {0};
+	struct smallshDeadline deadline = { -1, 0, 0, 0 };
+	int stopped = waitPipeline(pids, statuses, launched, &feederStatus, &usage, &deadline, track);
+	if (stopped != -1) {
+		char commandLine[JOB_TEXT_SIZE];
+		describePipeline(input, commandLine, sizeof(commandLine));
+		stopForegroundJob(pids + stopped, launched - stopped, WEXITSTATUS(feederStatus) - 128, commandLine, 0, &deadline, &usage, track, startNanos);
 	}
 }
 
 
 /*	FUNCTION: smallshExecuteInput
 this function interprets the command struct and decides whether to run a built-in command or pass the command to an exec() function 
-with pointers to the necessary status PID variables
+with the main loop's context, which has the status and usage of the last foreground command and the job table. returns 1 if a 
+foreground command got killed with ^C, which stops whatever loop or list it was part of like it does in other shells
 */
-void smallshExecuteInput(struct smallshCommand* inputCommand, int* childStatus, pid_t* backgroundPids, struct sigaction sa) {
+static int smallshExecuteInput(struct smallshCommand* inputCommand, struct smallshContext* context) {
 
 	if (inputCommand != NULL) {
-		//if our command is exit, set the exitShell var in our command struct to true 
-		if (strcmp(inputCommand->command, "exit") == 0) {
-			inputCommand->exitShell = 1;
-			return;
+		//fill in '$?', '$VAR' and the rest now rather than when the line was parsed, so they see everything that's run up to this point
+		expandCommand(inputCommand, context);
+		//a command that was only a '$(...)' which printed nothing has nothing left to run, and keeps the status the substitution left
+		if (inputCommand->command == NULL && inputCommand->stageCount == 1) {
+			return 0;
 		}
-		//a comment line shoud effectively do nothing, so we just return out of this execute function and the shell loop will start over
-		//here we check if the first character of the first token is a '#' to account for it being surrounded by spaces or just the first character of a string followed by non whitespace
-		else if (inputCommand->arguments[0][0] == '#') {
-			return;
+
+		//builtins only run when they're the whole line, a builtin in a pipeline stage gets passed to exec() like anything else. the same 
+		//goes for builtins that have a real program behind them when they're sent to the background, which a builtin can't do. the 
+		//exception is a builtin that reads its input at the end of a foreground pipeline, which the stages in front of it feed
+		struct smallshBuiltin* builtin = (inputCommand->command != NULL) ? findBuiltin(inputCommand->command) : NULL;
+		int background = (inputCommand->ampersand == 1) && (foregroundOnlyMode != 1);
+		struct smallshCommand* lastStage = inputCommand;
+		while (lastStage->nextStage != NULL) {
+			lastStage = lastStage->nextStage;
 		}
-		//built-in cd command
-		else if (strcmp(inputCommand->command, "cd") == 0) {
-			smallshCD(inputCommand);
+		struct smallshBuiltin* lastBuiltin = (lastStage != inputCommand && lastStage->command != NULL) ? findBuiltin(lastStage->command) : NULL;
+		if (builtin != NULL && (builtin->wholePipeline || (inputCommand->stageCount == 1 && !(builtin->hasProgram && background)))) {
+			runBuiltin(builtin, inputCommand, context);
 		}
-		//check the status of the last foreground exec() call. childStatus exists in the scope of the main loop so we can keep track of it between commands
-		else if (strcmp(inputCommand->command, "status") == 0) {
-			if (WIFEXITED(*childStatus)) {
-				printf("Child exit status: %d\n", WEXITSTATUS(*childStatus));
-			}
-			else {
-				printf("Child exited abnormally due to signal: %d\n", WTERMSIG(*childStatus));
-			}
+		else if (lastBuiltin != NULL && lastBuiltin->readsInput && !background) {
+			runPipedBuiltin(lastBuiltin, inputCommand, context);
 		}
 		//check for the ampersand member variable which will be set by our parsing function, if its true we know we want to run this command in the background
-		else if ((inputCommand->ampersand == 1) && (foregroundOnlyMode != 1)) {
-			callExecBackground(inputCommand, backgroundPids);
+		else if (background) {
+			pid_t lastPid = callExecBackground(inputCommand, context->jobTable, context->sa);
+			if (lastPid != -1) {
+				context->lastBackgroundPid = lastPid;
+			}
 		}
 		//pass all other commands & arguments to an exec() function to be called in the foreground
 		else {
-			callExecForeground(inputCommand, childStatus, sa);
+			context->timedOut = callExecForeground(inputCommand, &context->childStatus, &context->lastUsage, context->sa);
+			return WIFSIGNALED(context->childStatus) && WTERMSIG(context->childStatus) == SIGINT;
 		}
 	}
+	return 0;
 }
 
 
-/*	FUNCTION: checkBackgroundPids
-this function gets called right before our main shell loop prints our command line prompt. it checks every PID in our 
-background PID array and if the process is done (ie. when waitpid() returns the process ID of the process we're checking, 
-not 0) we clear that entry in the background PID array and waitpid() clears the zombie and prints out the PID of what it just cleaned up
-*/
-void checkBackgroundPids(pid_t* backgroundArray) {
-	int childStatus;
-	pid_t childPid;
-	for (int i = 0; i < MAX_BACKGROUND_PIDS; i++) {
-		if (backgroundArray[i] != 0) {
-			
-			childPid = waitpid(backgroundArray[i], &childStatus, WNOHANG);
-			
-			if (childPid > 0) {
-				if (WIFEXITED(childStatus)) {
-					printf("Background process %d exited with status: %d\n", backgroundArray[i], WEXITSTATUS(childStatus));
-				}
-				else {
-					printf("Background process %d exited abnormally due to signal: %d\n", backgroundArray[i], WTERMSIG(childStatus));
+//looks up a shell variable, NULL if there isn't one with that name
+struct smallshVariable* findVariable(struct smallshContext* context, const char* name) {
+	for (struct smallshVariable* variable = context->variables; variable != NULL; variable = variable->next) {
+		if (strcmp(variable->name, name) == 0) {
+			return variable;
+		}
+	}
+	return NULL;
+}
+
+
+//sets a shell variable, making it if it doesn't exist. the value is copied into the variable's own buffer
+static void setVariable(struct smallshContext* context, const char* name, const char* value) {
+
+	struct smallshVariable* variable = findVariable(context, name);
+	if (variable == NULL) {
+		variable = malloc(sizeof(struct smallshVariable));
+		variable->name = strdup(name);
+		variable->value = NULL;
+		variable->capacity = 0;
+		variable->next = context->variables;
+		context->variables = variable;
+	}
+
+	size_t length = strlen(value);
+	if (length + 1 > variable->capacity) {
+		variable->capacity = (length + 1 > 32) ? length + 1 : 32;
+		variable->value = realloc(variable->value, variable->capacity);
+	}
+	memcpy(variable->value, value, length + 1);
+}
+
+
+//true if a wait() status means success, which is what if and while go by
+static int statusSucceeded(int status) {
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+
+/*	FUNCTION: smallshExecuteNodes
+runs a list of parsed nodes in order, skipping a node after a '&&' when the status so far isn't a success and one after a '||' when 
+it is. that's the same status 'status' reports, and a skipped node leaves it alone, so 'a && b || c' works like it does in sh. loops run their body nodes over and over without parsing anything again, each pass only redoes 
+the expansions, and whatever those allocated is thrown away after each command so a long loop doesn't grow the arena. a while loop 
+or an if is the status of the last command in its body, or 0 if the body never ran, like in sh. returns 1 if the rest of the line 
+should be skipped, because of 'exit' or a ^C
+*/
+int smallshExecuteNodes(struct smallshNode* node, struct smallshContext* context) {
+
+	for (; node != NULL; node = node->next) {
+
+		if ((node->connector == RUN_IF_SUCCEEDED && !statusSucceeded(context->childStatus)) || (node->connector == RUN_IF_FAILED && statusSucceeded(context->childStatus))) {
+			continue;
+		}
+
+		struct smallshArenaMark mark = arenaMark(context->arena);
+		int stop = 0;
+
+		if (node->type == NODE_COMMAND) {
+			stop = smallshExecuteInput(node->command, context);
+		}
+		else if (node->type == NODE_FOR) {
+			//the words are expanded once when the loop starts, so they live until the loop is done. a '$(...)' can make any number of them
+			char** words = node->words;
+			int wordCount = node->wordCount;
+			if (node->wordsExpand) {
+				struct smallshCommand expanded = { .words = node->words, .wordCount = node->wordCount, .needsExpansion = 1 };
+				expandCommand(&expanded, context);
+				words = expanded.arguments;
+				wordCount = expanded.argCount;
+			}
+			context->childStatus = 0;
+			for (int i = 0; i < wordCount && !stop; i++) {
+				setVariable(context, node->variable, words[i]);
+				stop = smallshExecuteNodes(node->body, context);
+			}
+		}
+		else if (node->type == NODE_WHILE) {
+			int bodyStatus = 0;
+			while (!stop) {
+				stop = smallshExecuteNodes(node->condition, context);
+				if (stop || !statusSucceeded(context->childStatus)) {
+					break;
 				}
-				backgroundArray[i] = 0;
+				stop = smallshExecuteNodes(node->body, context);
+				bodyStatus = context->childStatus;
+			}
+			if (!stop) {
+				context->childStatus = bodyStatus;
+			}
+		}
+		else if (node->type == NODE_IF) {
+			stop = smallshExecuteNodes(node->condition, context);
+			if (!stop && statusSucceeded(context->childStatus)) {
+				stop = smallshExecuteNodes(node->body, context);
 			}
+			else if (!stop && node->elseBody != NULL) {
+				stop = smallshExecuteNodes(node->elseBody, context);
+			}
+			else if (!stop) {
+				context->childStatus = 0;
+			}
+		}
+
+		arenaRelease(context->arena, mark);
+		if (stop || context->exitShell) {
+			return 1;
 		}
 	}
+	return 0;
 }
 
 
-/*	FUNCTION: smallshMainLoop
-our main command line shell loop, basically does: 
-1. check for background PIDs and kills any that are done
-2. prints our command line prompt and waits for user input
-3. parses user input into a struct
-4. executes the struct
-5. cleans up the allocated memory in the struct and then repeats
-the only parameter is the signal handler for SIGINT, so we can pass it to our callExecForeground() function, this way we can 
-change it when it creates a child process to its default behavior
+/*	FUNCTION: handleEpollEvent
+everything in the job table's epoll set gets a data pointer that says what it is: NULL for stdin, the path cache for its inotify fd, the 
+job output set when some jobs' output pipes have something to read, the job control struct for the SIGCHLD signalfd, and a process struct for a pidfd. this does whatever that thing needs and 
+returns 1 if it was stdin that's ready, 0 otherwise
 */
-void smallshMainLoop(struct sigaction sa) {
-	
-	int exitShell = 0;
-	char* rawLine = NULL;
-	int childStatus = 0; //this is storage for the childstatus of the last foreground process that was run
-	pid_t backgroundPids[MAX_BACKGROUND_PIDS]; //this array holds the PIDs of all currently running background processes
-	for (int i = 0; i < MAX_BACKGROUND_PIDS; i++) {
-		backgroundPids[i] = 0;
+static int handleEpollEvent(struct smallshJobTable* jobTable, void* eventData) {
+
+	if (eventData == NULL) {
+		return 1;
+	}
+	else if (eventData == &pathCache) {
+		pathCacheHandleEvents();
 	}
+	else if (eventData == &jobOutputs) {
+		jobOutputsDrainReady();
+	}
+	else if (eventData == &jobDeadlineFD) {
+		jobDeadlinesExpired();
+	}
+	else if (eventData == &jobControl) {
+		jobStopsCheck(jobTable);
+	}
+	else {
+		reapProcess(jobTable, eventData, 0, NULL);
+	}
+	return 0;
+}
+
+
+/*	FUNCTION: checkBackgroundPids
+this function gets called right before our main shell loop prints our command line prompt. instead of calling waitpid() on every 
+background PID to see if it's done, we ask the epoll set which pidfds have become readable, which is a single syscall that only tells 
+us about processes that actually finished. each of those gets reaped, and its job gets reported once all of its processes are done. 
+the only processes that still get checked one at a time are ones that we couldn't get a pidfd for
+*/
+void checkBackgroundPids(struct smallshJobTable* jobTable) {
 
-	struct smallshCommand* parsedLine = NULL;
+	struct epoll_event events[MAX_EPOLL_EVENTS];
+	int eventCount;
 
 	do {
-		checkBackgroundPids(backgroundPids);
-		fflush(stdout);
-		
-		printf(": ");
-		fflush(stdout);
-		rawLine = smallshGetInput();
-		parsedLine = smallshParseInput(rawLine);
-		
-		if (parsedLine != NULL) {
-			smallshExecuteInput(parsedLine, &childStatus, backgroundPids, sa);
-			exitShell = parsedLine->exitShell;
-			freeCommandStructMembers(parsedLine);
-			free(parsedLine);
+		eventCount = epoll_wait(jobTable->epollFD, events, MAX_EPOLL_EVENTS, 0);
+		for (int i = 0; i < eventCount; i++) {
+			handleEpollEvent(jobTable, events[i].data.ptr);
 		}
-		
-		fflush(stdout);
-		free(rawLine);
+	} while (eventCount == MAX_EPOLL_EVENTS);
 
-	} while (!exitShell);
-} 
+	//a foreground wait read the SIGCHLDs, so jobs that stopped meanwhile wouldn't show up in the epoll set
+	if (jobControl.stopsPending) {
+		jobStopsCheck(jobTable);
+	}
+
+	if (jobTable->unwatchedCount > 0) {
+		for (int i = 0; i < jobTable->jobCount; i++) {
+			struct smallshJob* job = jobTable->jobs[i];
+			for (int proc = 0; proc < job->procCount; proc++) {
+				if (!job->procs[proc].done && job->procs[proc].pidfd == -1) {
+					int lastLive = (job->liveCount == 1);
+					if (reapProcess(jobTable, &job->procs[proc], WNOHANG, NULL) && lastLive) {
+						//the job was just free'd and the ones after it slid down a slot
+						i--;
+						break;
+					}
+				}
+			}
+		}
+	}
+}
 
 
-/*	FUNCTION: handler_SIGTSTOP
-this is our signal handler for SIGTSTP, it basically just toggles a global variable (I have no idea how to pass another value here) 
-that when true will run all commands using callExecForeground()
+/*	FUNCTION: waitForInput
+when the shell is interactive this gets called after the prompt is printed, and sleeps in epoll_wait() until either there's something 
+to read on stdin or a background process exits. that way a finished job gets reported the moment it's done instead of the next time 
+the user hits enter, and then the prompt gets put back so they can keep typing
 */
-void handler_SIGTSTP(int signo) {
+static void waitForInput(struct smallshJobTable* jobTable) {
 
-	if (foregroundOnlyMode == 0) {
-		char* foregroundMessage = "\nEntering foreground-only mode (& is now ignored)\n:";
-		write(1, foregroundMessage, 51);
-		fflush(stdout);
-		foregroundOnlyMode = 1;
+	struct epoll_event events[MAX_EPOLL_EVENTS];
+
+	if (!jobTable->interactive) {
+		return;
 	}
-	else {
-		char* foregroundMessage = "\nExiting foreground-only mode\n:";
-		write(1, foregroundMessage, 31);
-		fflush(stdout);
-		foregroundOnlyMode = 0;
+
+	jobTable->promptShowing = 1;
+
+	while (1) {
+		int eventCount = epoll_wait(jobTable->epollFD, events, MAX_EPOLL_EVENTS, -1);
+		int inputReady = 0;
+
+		//EINTR here is just our SIGTSTP handler going off (when there's no job control), it already printed its own message and prompt
+		for (int i = 0; i < eventCount; i++) {
+			if (handleEpollEvent(jobTable, events[i].data.ptr)) {
+				inputReady = 1;
+			}
+		}
+
+		//something got reported, so the prompt needs to be printed again under it
+		if (!jobTable->promptShowing) {
+			printf(": ");
+			fflush(stdout);
+			jobTable->promptShowing = 1;
+		}
+		if (inputReady) {
+			break;
+		}
 	}
+
+	jobTable->promptShowing = 0;
 }
 
 
+/*	FUNCTION: smallshMainLoop
+our main command line shell loop, basically does: 
+1. check for background jobs and reaps any that are done
+2. prints our command line prompt and waits for user input (reporting any jobs that finish while we wait, if we're interactive)
+3. parses user input into a struct
+4. executes the struct
+5. resets the line's arena, which throws away the struct and everything in it, and then repeats
+until 'exit' or the input runs out. when running a script or a -c string there's no prompt and none of the flushing that's only there 
+to keep a terminal looking right. the parameters are the signal handler for SIGINT, so we can pass it to our callExecForeground() function, 
+this way we can change it when it creates a child process to its default behavior, and where the command lines come from. returns the 
+exit code the shell should exit with, which is the status of the last command
+*/
+int smallshMainLoop(struct sigaction sa, struct smallshInput* input) {
+	
+	char* rawLine = NULL;
+	struct smallshArena lineArena = {0}; //everything parsed out of a line is allocated here and thrown away all at once when the line is done
+	struct smallshLineCache* lineCache = calloc(1, sizeof(struct smallshLineCache)); //lines that repeat get parsed once and kept here
+	struct smallshJobTable jobTable; //this holds all of the currently running background jobs
+	jobTableInit(&jobTable, input->showPrompt && isatty(input->fd));
+	pathCacheInit(jobTable.epollFD);
+	if (jobTable.interactive) {
+		jobControlInit(&jobTable);
+	}
+	//the status of the last foreground command and what it cost, plus everything else a builtin might need
+	struct smallshContext context = { 0, {0}, &jobTable, sa, &lineArena, 0, NULL, 0, 0 };
 
+	struct smallshNode* parsedLine = NULL;
 
-int main() {
+	do {
+		checkBackgroundPids(&jobTable);
+		
+		if (input->showPrompt) {
+			fflush(stdout);
+			printf(": ");
+			fflush(stdout);
+			if (!inputHasLine(input)) {
+				waitForInput(&jobTable);
+			}
+		}
+		long long traceStarted = traceNow();
+		rawLine = smallshGetInput(input, &lineArena);
+		traceEvent("getInput", traceStarted, 0, -1, -1);
+		if (rawLine == NULL) {
+			break;
+		}
 
-	//set up out signal handler to ignore sigint in the main shell
-	struct sigaction SIGINT_action = {0};
-	SIGINT_action.sa_handler = SIG_IGN;
-	sigfillset(&SIGINT_action.sa_mask);
-	SIGINT_action.sa_flags = SA_RESTART; //we need to set SA_RESTART here so getline() doesn't get screwed up
-	sigaction(SIGINT, &SIGINT_action, NULL);
+		//a for, while or if can go on for more lines, in that case the lines get joined with newlines and the whole thing is parsed 
+		//again, which needs an untouched copy since the lexer writes over whatever it parses
+		char* pending = lineMayContinue(rawLine) ? arenaStrndup(&lineArena, rawLine, strlen(rawLine)) : NULL;
+		int incomplete;
+		traceStarted = traceNow();
+		parsedLine = lineCacheParse(lineCache, rawLine, &lineArena, &incomplete);
+		traceEvent("parse", traceStarted, 0, -1, -1);
+
+		while (incomplete == 1 && pending != NULL) {
+			if (input->showPrompt) {
+				printf("> ");
+				fflush(stdout);
+			}
+			char* nextLine = smallshGetInput(input, &lineArena);
+			if (nextLine == NULL) {
+				fprintf(stderr, "smallsh: syntax error, unexpected end of input\n");
+				break;
+			}
+			size_t pendingLen = strlen(pending);
+			size_t nextLen = strlen(nextLine);
+			char* joined = arenaAlloc(&lineArena, pendingLen + nextLen + 2);
+			memcpy(joined, pending, pendingLen);
+			joined[pendingLen] = '\n';
+			memcpy(joined + pendingLen + 1, nextLine, nextLen + 1);
+			pending = joined;
+			traceStarted = traceNow();
+			parsedLine = smallshParseInput(arenaStrndup(&lineArena, joined, pendingLen + nextLen + 1), &lineArena, &incomplete);
+			traceEvent("parse", traceStarted, 0, -1, -1);
+		}
+		
+		if (parsedLine != NULL) {
+			smallshExecuteNodes(parsedLine, &context);
+		}
+		//a line that didn't parse (or never got finished) ran nothing, but it still counts as a failed command
+		else if (incomplete != 0) {
+			context.childStatus = W_EXITCODE(SYNTAX_ERROR, 0);
+			context.timedOut = 0;
+		}
+		
+		if (input->showPrompt) {
+			fflush(stdout);
+		}
+		arenaReset(&lineArena);
 
-	struct sigaction SIGTSTP_action = {0};
-	SIGTSTP_action.sa_handler = handler_SIGTSTP;
-	sigfillset(&SIGTSTP_action.sa_mask);
-	SIGTSTP_action.sa_flags = SA_RESTART; //we need to set SA_RESTART again
-	sigaction(SIGTSTP, &SIGTSTP_action, NULL);
+	} while (!context.exitShell);
 
-	smallshMainLoop(SIGINT_action);
+	fflush(stdout);
+	jobControlEnd();
 
-	return EXIT_SUCCESS;
-}
\ No newline at end of file
+	//turn the last status into an exit code the way other shells do, 128 plus the signal number if it was killed
+	if (WIFEXITED(context.childStatus)) {
+		return WEXITSTATUS(context.childStatus);
+	}
+	return 128 + WTERMSIG(context.childStatus);
+} 
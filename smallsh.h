@@ -0,0 +1,624 @@
+/***************************************************************************************
+* Program: SmallShell 
+* Author: Lucas Moyle
+* Description: everything the shell is made of, shared between the shell's main() and the 
+*	benchmark harness in bench/. the structs, the shell-wide settings and every function 
+*	that's used outside the file it's in are declared here, the rest are static. main.c 
+*	just sets up signals and picks where the input comes from.
+***************************************************************************************/
+
+#ifndef SMALLSH_H
+#define SMALLSH_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE //for pipe2(), splice() and friends, this header has to be included before any system header
+#endif
+
+#include <sys/wait.h> 
+#include <sys/types.h>
+#include <stdio.h>    
+#include <stdlib.h>   
+#include <unistd.h>   
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/pidfd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <termios.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sched.h>
+#include <ctype.h>
+#include <limits.h>
+
+
+#define INITIAL_ARGUMENTS 16 //starting size of a command's argument array, it doubles whenever a command has more arguments than that
+#define ARENA_BLOCK_SIZE 4096 //smallest block the per-line arena will malloc(), bigger lines get bigger blocks
+#define ARENA_ALIGNMENT (sizeof(void*)) //every arena allocation gets rounded up to a multiple of this
+#define INPUT_BLOCK_SIZE (1 << 16) //how much we ask read() for at a time when reading commands from stdin, lines get split out of that block in memory
+#define PARALLEL_PLACEHOLDER "{}" //where each input line goes in a 'parallel' command template, if it's not in the template the line is tacked on the end
+#define PARALLEL_MAX_FAILED 101 //'parallel' exits with the number of tasks that failed, capped here like GNU parallel does so it can't look like a signal
+#define ALLOC_STATS_ENV_VAR "SMALLSH_ALLOC_STATS" //debug builds print per-line allocation counts to stderr when this is set
+#define INITIAL_JOB_SLOTS 16 //starting size of the job table's job array, it doubles when it fills up
+#define INITIAL_PID_BUCKETS 64 //starting number of buckets in the job table's PID hash, it doubles when there are more live processes than buckets
+#define MAX_EPOLL_EVENTS 64 //how many events we take from epoll_wait() at a time
+#define INITIAL_HASH_BUCKETS 64 //starting number of buckets in the command path cache, it doubles when there are more commands than buckets
+#define PATH_WATCH_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF) //anything that could change what a name in a $PATH directory resolves to
+#define SPLICE_CHUNK (1 << 16) //how many bytes we ask splice() to move per call when a pipeline stage is just a file redirect
+#define PLACEMENT_PREFIX '@' //a line whose first word starts with this has placement settings in front of the command, like '@cpu=2-5 nice=10 cmd'
+#define PLACEMENT_DESCRIPTION_SIZE 128 //room for the 'cpu=... nice=...' text that 'jobs -l' shows for a job
+#define REDIRECT_HIGH_FD 10 //files opened for redirects get moved up to at least this descriptor so a redirect like '3> file' can't clobber one that's still needed
+#define REDIRECT_NOT_SAVED -2 //a builtin's redirect that didn't need the shell's descriptor saved, see redirectBuiltin()
+#define BUILTIN_KEEP_STATUS -1 //what a builtin returns when it shouldn't change the status that 'status' reports
+#define TEST_ERROR 2 //the status 'test' and '[' exit with when the expression itself is bad
+#define SYNTAX_ERROR 2 //the status a line that can't be parsed leaves behind, like in other shells
+#define PARSE_FAILED -1 //what smallshParseInput() sets its incomplete flag to for a bad line, so it can be told apart from an empty one
+#define EXPANSION_MARK '\x01' //the lexer writes this in place of the '$' of an expansion, the name ('$', '?', '!' or a variable name) or a SUBSTITUTION_ byte follows it
+#define EXPANSION_END '\x02' //ends a variable name after an EXPANSION_MARK when the next byte of the word would otherwise look like part of the name
+#define SUBSTITUTION_SPLIT '(' //follows an EXPANSION_MARK for an unquoted '$(...)', the command text comes next and an EXPANSION_END ends it. its output is split into words
+#define SUBSTITUTION_QUOTED '"' //the same for a '"$(...)"', whose output stays one word
+#define SUBSTITUTION_PIPE_SIZE (1 << 20) //what F_SETPIPE_SZ asks for on a substitution's pipe once it has a lot of output, if we're not allowed that much it stays at the default 64 KiB
+#define CAPTURE_GROW_PIPE_AT (1 << 14) //how much a substitution has to print before its pipe gets made SUBSTITUTION_PIPE_SIZE
+#define CAPTURE_INITIAL_SIZE 4096 //starting size of the buffer a substitution's output is read into, it doubles as it fills
+#define GLOB_STAR '\x03' //the lexer writes this in place of an unquoted '*', so a quoted one stays an ordinary '*'
+#define GLOB_ONE '\x04' //the same for an unquoted '?'
+#define GLOB_BRACKET '\x05' //the same for an unquoted '[' that has a ']' after it in the same word, the rest of the bracket expression is left as it is
+#define GLOB_CACHE_SLOTS 32 //how many directory listings the glob cache keeps, the one that went longest without being used gets replaced
+#define GLOB_DIRENT_BUFFER (1 << 18) //how many bytes of directory entries getdents64() gets asked for at a time when a directory is read
+#define GLOB_RACY_NANOS 100000000LL //a directory whose mtime was less than this long before it was read could have changed in the same mtime tick, so it gets read again the next time
+#define TIMEOUT_SIGNAL SIGTERM //what a command that runs out of time gets sent unless 'timeout -s' says otherwise
+#define TIMEOUT_GRACE_NANOS 5000000000LL //how long a command gets to exit after that signal before it gets SIGKILL, 'timeout -k' changes it
+#define JOB_OUTPUT_SIZE (1 << 16) //with 'set -o joboutput', how much of what each background job printed is kept, the newest bytes win
+#define JOB_OUTPUT_SLOTS 64 //how many jobs' output can be kept at once, so it never takes more than JOB_OUTPUT_SLOTS * JOB_OUTPUT_SIZE bytes
+#define TRACE_ENV_VAR "SMALLSH_TRACE" //set this to a file name to have a Chrome trace-event JSON timeline of the session written there at exit
+#define TRACE_MAX_EVENTS (1 << 16) //how many events the trace buffer holds, it's allocated once when tracing starts
+#define TRACE_MAX_TRACKS 4096 //how many pipelines get a track of their own in the trace, after that they share the shell's
+#define TRACE_TRACK_NAME 64 //room for the command line a track is named after
+#define JOB_TEXT_SIZE 256 //room for the command line of a foreground pipeline that gets stopped, which 'jobs' shows like a background job's
+#define LEXER_ENV_VAR "SMALLSH_LEXER" //set this to "avx2", "sse2" or "scalar" to force one of the lexer's scanners, mostly for benchmarking
+#define LINE_CACHE_SLOTS 64 //how many parsed lines the line cache holds, must be a power of 2
+#define LAUNCHER_ENV_VAR "SMALLSH_LAUNCHER" //set this to "fork" or "spawn" before starting smallsh to pick how children get launched, the 'launcher' builtin can change it afterwards
+
+enum launcherType { LAUNCH_SPAWN, LAUNCH_FORK };
+enum redirectType { REDIRECT_INPUT, REDIRECT_OUTPUT, REDIRECT_APPEND, REDIRECT_DUP, REDIRECT_CLOSE, REDIRECT_STRING };
+enum tokenType { TOKEN_WORD, TOKEN_PIPE, TOKEN_AMPERSAND, TOKEN_REDIRECT, TOKEN_SEPARATOR, TOKEN_NEWLINE, TOKEN_AND, TOKEN_OR };
+enum nodeType { NODE_COMMAND, NODE_FOR, NODE_WHILE, NODE_IF };
+enum listConnector { RUN_ALWAYS, RUN_IF_SUCCEEDED, RUN_IF_FAILED };
+enum lexMode { LEX_UNQUOTED, LEX_DOUBLE_QUOTED, LEX_SINGLE_QUOTED, LEX_MODE_COUNT };
+
+#define TOKEN_QUOTED 1 //token flag, some of the word was quoted or escaped, so it can't be an '@' placement prefix or a descriptor number
+#define TOKEN_EXPANDS 2 //token flag, the word has expansion markers in it that expandWord() has to fill in before it's used
+#define TOKEN_GLOBS 4 //token flag, the word has GLOB_ markers in it that globWord() matches against file names before it's used
+
+
+//this is the bump allocator that everything parsed out of one input line lives in. allocating is just moving a pointer forward in the 
+//current block, and when the line is done the whole thing gets reset instead of free'd piece by piece. blocks are only malloc'd when a 
+//line is bigger than anything we've seen before, so once the shell has warmed up a normal line doesn't touch malloc() at all
+struct smallshArenaBlock {
+	struct smallshArenaBlock* next; //the block that was filled up before this one
+	size_t size; //usable bytes in data
+	size_t used; //bytes handed out so far
+	char data[];
+};
+
+//a spot in an arena to go back to with arenaRelease(), so a loop can throw away what each run of its body allocated without 
+//throwing away the line
+struct smallshArenaMark {
+	struct smallshArenaBlock* block;
+	size_t used;
+};
+
+struct smallshArena {
+	struct smallshArenaBlock* current; //the block we're bumping through, older full blocks hang off of its next pointer
+	size_t totalSize; //sum of the sizes of every block, used to size the single replacement block when the arena gets reset
+#ifndef NDEBUG
+	long allocCount; //number of arenaAlloc() calls since the last reset
+	long mallocCount; //number of those that had to go to malloc() for a new block
+#endif
+};
+
+//one redirection on a pipeline stage. they're kept in the order they were written since later ones can depend on earlier ones, like 
+//'> out 2>&1' sending stderr to wherever stdout has just been pointed
+struct smallshRedirect {
+	int fd; //the descriptor of the command that gets changed, 0 for '<' and 1 for '>' unless a number was written in front
+	enum redirectType type;
+	char* target; //the file name or here-string, NULL for dups and closes
+	char* word; //the target as the lexer left it when it has expansions in it, expandCommand() makes a new target from it every run. NULL otherwise
+	int sourceFD; //what gets dup2()'d onto fd: for REDIRECT_DUP the descriptor named after the '&', otherwise what openRedirects() opened, -1 if nothing is open
+	int savedFD; //when a builtin runs with this redirect, where the shell's own fd went so restoreBuiltin() can put it back. -1 if fd wasn't open
+	struct smallshRedirect* next;
+};
+
+//where the processes of a command should run and how nice they should be. a line can give its own with an '@cpu=2-5 nice=10' prefix, 
+//otherwise background jobs get one from the shell's placement settings
+struct smallshPlacement {
+	int hasCPUs; //a bool, true if cpus should be applied
+	cpu_set_t cpus;
+	int hasNice; //a bool, true if niceValue should be applied
+	int niceValue; //the nice value the processes get, not an increment, so 'nice=10' from a shell at 0 is the same as 'nice -n 10'
+};
+
+//the shell-wide placement settings that the 'placement' builtin changes. background jobs are handed out one CPU each, round robin, 
+//from the background set (or every CPU the shell can use) minus the CPUs reserved for the foreground
+struct smallshPlacementSettings {
+	int hasBackgroundCPUs; //a bool, true if 'placement bg' gave a set
+	cpu_set_t backgroundCPUs;
+	int hasForegroundCPUs; //a bool, true if 'placement fg' reserved some CPUs, foreground commands get pinned to them and background jobs stay off them
+	cpu_set_t foregroundCPUs;
+	int hasBackgroundNice; //a bool, true if 'placement nice' gave a value
+	int backgroundNice;
+	int nextCPU; //where the round robin picks up looking for the next background CPU
+};
+
+//this is our command struct that an input line will be parsed in to, it and everything it points to are allocated out of the line's arena
+struct smallshCommand {
+	char* fullInput; //a copy of this pipeline's part of the input line from before it was lexed, for the job table. only made for pipelines that end in '&', NULL otherwise
+	char* command; //the first word, this just points at arguments[0]
+	char** arguments; //the words, NULL terminated so it can go straight to exec(). it grows as needed so there's no limit on the argument count
+	char** words; //when needsExpansion is set, the words as the lexer left them with their expansion markers, arguments gets rebuilt from these every run
+	int wordCount; //the number of words, which can be different from argCount once a '$(...)' has been split into however many words it printed
+	int needsExpansion; //a bool that's true when any word or redirect target in this stage has a '$' expansion in it, or a word has a glob
+	int argCount; //the number of non-null entries in the arguments array
+	int argCapacity; //the number of slots in the arguments array, including the one for the terminating NULL
+	struct smallshRedirect* redirects; //every '<', '>', '>>', '2>&1', '<<<' and so on in this stage, in the order they were written. none of them go in the args array
+	int ampersand; //a bool that if true tells the program to run the command in the background
+	struct smallshCommand* nextStage; //the next command in a '|' pipeline, this stage's stdout gets connected to its stdin. NULL for the last (or only) stage
+	int stageCount; //only meaningful on the first stage, the total number of stages in the pipeline
+	struct smallshPlacement* placement; //only on the first stage, the settings from an '@cpu=... nice=...' prefix or NULL if the line didn't have one
+	struct smallshTimeout* timeout; //only on the first stage, the limit a 'timeout' builtin is running it with, or NULL for the shell's default
+};
+
+//a parsed line is a list of these. most lines are a single NODE_COMMAND, the others are the for, while and if constructs, whose bodies 
+//are lists of nodes themselves. the whole tree is parsed once and can be run any number of times, only the expansions get redone
+struct smallshNode {
+	enum nodeType type;
+	enum listConnector connector; //whether the node runs no matter what (after a ';', newline or '&'), or only after the status before it succeeded ('&&') or failed ('||')
+	struct smallshCommand* command; //NODE_COMMAND: the pipeline to run
+	char* variable; //NODE_FOR: the name of the loop variable
+	char** words; //NODE_FOR: the words after 'in', as the lexer left them
+	int wordCount;
+	int wordsExpand; //NODE_FOR: a bool that's true if any of the words have expansions or globs in them
+	struct smallshNode* condition; //NODE_WHILE and NODE_IF: the list whose status decides whether the body runs
+	struct smallshNode* body; //the loop body, or the 'then' list of an if
+	struct smallshNode* elseBody; //NODE_IF: the 'else' list, an 'elif' is another NODE_IF in here. NULL if there isn't one
+	struct smallshNode* next; //the next node in the same list
+};
+
+//a shell variable, like a for loop's variable. they aren't exported, so commands only see them through '$NAME'
+struct smallshVariable {
+	char* name;
+	char* value;
+	size_t capacity; //the size of value's buffer, it only gets realloc'd when a longer value comes along so a loop doesn't malloc() every time around
+	struct smallshVariable* next;
+};
+
+
+//what a job cost to run. the CPU time, context switches and max RSS come from the rusage wait4() hands back when each process is reaped, 
+//for a pipeline they're added up over all of the stages (except max RSS, which is the biggest of them). wall time is from launch to the 
+//last process being reaped
+struct smallshUsage {
+	long long wallNanos;
+	struct timeval userTime;
+	struct timeval systemTime;
+	long maxRSS; //in KiB, like ru_maxrss
+	long voluntarySwitches;
+	long involuntarySwitches;
+};
+
+//one process in a background job. every process gets a pidfd that sits in the job table's epoll set, the pidfd becomes readable when the 
+//process exits so we only ever call waitpid() on processes that are actually done
+struct smallshProcess {
+	pid_t pid;
+	int pidfd; //-1 if pidfd_open() didn't work, in that case the process gets checked with WNOHANG like the old PID array was
+	int status; //the status from waitpid() once the process has been reaped
+	int done; //a bool that's true once the process has been reaped
+	struct smallshJob* job; //the job this process belongs to
+	struct smallshProcess* hashNext; //the next process in the same bucket of the job table's PID hash
+};
+
+//a time limit that a command can be run with, from a 'timeout' in front of it or the shell's default
+struct smallshTimeout {
+	long long nanos; //how long the command gets, 0 for no limit
+	int signal; //what it gets sent when that runs out
+	long long graceNanos; //how long after that it gets SIGKILL, 0 for never
+};
+
+//a time limit that's running. a timerfd goes off when the time is up and again when the grace period after the signal is, so the shell 
+//can sleep on it in the same poll() or epoll set as the processes themselves and nothing has to sleep or poll to keep time
+struct smallshDeadline {
+	int timerFD; //nonblocking, -1 if there's no limit
+	int signal;
+	long long graceNanos;
+	int expired; //0 while there's time left, 1 once the signal has been sent and 2 once SIGKILL has
+};
+
+//a background job is everything that was launched by one line, so a pipeline is one job with a process for each stage
+struct smallshJob {
+	int id; //the job number that 'jobs' shows, numbers get reused once the table is empty
+	int procCount; //the number of processes in the job
+	int liveCount; //the number of those that haven't been reaped yet
+	char* commandLine; //a malloc'd copy of the line that started the job, for 'jobs'
+	char* placement; //a malloc'd description of where the job was placed like 'cpu=3 nice=10', for 'jobs -l'. NULL if it runs wherever the shell does
+	long long startNanos; //when the job was launched, for its wall time
+	int traceTrack; //the job's track in the trace, 0 when tracing is off
+	struct smallshDeadline deadline; //the job's time limit, its timerFD sits in the jobDeadlineFD epoll set. timerFD is -1 if it doesn't have one
+	pid_t group; //the job's process group, which 'fg', 'bg' and 'kill %n' signal all at once. 0 if it was started without job control
+	int stopped; //the signal that stopped the job (SIGTSTP for a ^Z) while it's stopped, until it's continued. 0 while it's running
+	struct smallshUsage usage; //what the job's processes have used so far, added to as each one is reaped
+	struct smallshProcess procs[]; //one per pipeline stage, in stage order
+};
+
+//what one background job has printed, kept when 'set -o joboutput' is on. the job's stdout and stderr go to a pipe in the job table's 
+//epoll set and get read into a ring that holds the newest JOB_OUTPUT_SIZE bytes. a slot outlives its job so 'jobs -o' works after 
+//the job is done, until the slot is needed for a newer job
+struct smallshJobOutput {
+	int readFD; //the read end of the job's pipe, nonblocking. -1 once every process in the job has closed its end (or the slot was never used)
+	pid_t* pids; //a malloc'd copy of the PIDs of the job's processes, so 'jobs -o' can find it by any of them. NULL if the slot is free
+	int pidCount;
+	char* ring; //JOB_OUTPUT_SIZE bytes, malloc'd the first time a job in this slot prints something and kept for whichever job gets the slot next
+	unsigned long long total; //how many bytes the job has printed in all, the ring holds the last JOB_OUTPUT_SIZE of them
+	unsigned long long sequence; //when the slot was handed out, the slot of the oldest finished job is the one that gets reused
+};
+
+//every background job the shell knows about. the jobs array has no fixed size, and the PID hash lets 'wait' and the reaper find any 
+//process in O(1) no matter how many jobs there are
+struct smallshJobTable {
+	struct smallshJob** jobs; //live jobs in the order they were started
+	int jobCount;
+	int jobCapacity;
+	struct smallshProcess** buckets; //chained hash of every unreaped process, keyed on PID
+	int bucketCount; //always a power of 2 so we can mask instead of mod
+	int processCount; //number of processes in the hash
+	int unwatchedCount; //number of processes that don't have a pidfd and have to be polled
+	int epollFD; //epoll set holding the pidfd of every live background process, plus stdin when the shell is interactive
+	int interactive; //a bool that's true when stdin is a terminal, in that case finished jobs get reported right away instead of at the next prompt
+	int promptShowing; //a bool that's true while the ': ' prompt is waiting for input, so a report knows to start on a new line and put the prompt back
+	int nextJobId;
+};
+
+//every job whose output is being kept. there's a fixed number of slots so the memory for it is bounded no matter how many jobs run
+struct smallshJobOutputs {
+	struct smallshJobOutput slots[JOB_OUTPUT_SLOTS];
+	unsigned long long sequence; //counts up as slots are handed out
+	int epollFD; //an epoll set of the slots' pipes, which sits in the job table's epoll set and gets polled by foreground waits. -1 until it's first needed
+};
+
+//everything from the main loop that a builtin might need, this way every builtin has the same signature and can go in the builtin table
+struct smallshContext {
+	int childStatus; //the wait() status of the last foreground command, this is what 'status' reports and what the shell exits with
+	struct smallshUsage lastUsage; //what that command cost to run, for 'status -v'
+	struct smallshJobTable* jobTable;
+	struct sigaction sa; //the SIGINT handler, so foreground children can get theirs put back to the default
+	struct smallshArena* arena; //the current line's arena, expansions are allocated out of it
+	pid_t lastBackgroundPid; //the PID of the last process of the last background job, for '$!'. 0 until there is one
+	struct smallshVariable* variables; //the shell variables, checked before the environment when a '$NAME' gets expanded
+	int exitShell; //a bool that 'exit' sets to stop the rest of the line and the main loop
+	int timedOut; //a bool that's true if the last foreground command ran out of time and got signaled, so 'status' can say so
+};
+
+//the output of a '$(...)' while its commands run. programs write to a pipe that the shell reads out into a buffer that grows as needed 
+//while it waits for them. builtins run in the shell, which is the pipe's only reader, so their stdout goes straight into the buffer instead
+struct smallshCapture {
+	int readFD; //the read end of the pipe, nonblocking so it can be emptied without waiting for more
+	dev_t pipeDevice; //which pipe it is, so a builtin's output can tell if fd 1 still points at it or was redirected somewhere else
+	ino_t pipeInode;
+	char* data; //what's been read so far, malloc'd
+	size_t length;
+	size_t capacity;
+	int pipeGrown; //a bool that's true once the pipe has been made SUBSTITUTION_PIPE_SIZE, see captureDrain()
+	struct smallshCapture* outer; //the capture this one is nested in, NULL if it isn't
+};
+
+//one word or operator from the lexer. a word's text has been dequoted in place in the input line and is null terminated there
+struct smallshToken {
+	enum tokenType type;
+	char* text; //the word, NULL for operators
+	int flags; //TOKEN_QUOTED and TOKEN_EXPANDS
+	int fd; //for a redirection, the descriptor it changes (a number written in front of it or the default for the operator)
+	enum redirectType redirect; //for a redirection, which kind it is. REDIRECT_DUP covers '>&' and '<&' until the target says if it's a close
+};
+
+//where the lexer is in a line. words get written back into the line as their quotes and backslashes come out, so out is always at or 
+//behind in. when a word ends right up against an operator with nothing removed from it, the word's null terminator lands on the operator, 
+//so the operator gets kept in held until it's lexed
+struct smallshLexer {
+	char* in; //the next byte to look at
+	char* out; //where the next byte of the current word gets written
+	char held; //the byte at in if it was written over, otherwise '\0'
+	int nameOpen; //a bool that's true right after a '$NAME' marker was written, so lexEmit() knows to end the name if a name character comes next
+};
+
+//the parser reads one token ahead of what it has parsed
+struct smallshParser {
+	struct smallshLexer lexer;
+	struct smallshToken token; //the token that's up next
+	int result; //what lexNext() returned for it: 1 for a token, 0 at the end of the line, -1 if the line couldn't be lexed
+	struct smallshArena* arena;
+	char* line; //the start of the line, so token positions can be found in fullInput
+	size_t tokenOffset; //where in the line the lexer started looking for the current token
+	char* fullInput; //the untouched copy of the line that the job table's command lines get cut out of, NULL if the line has no '&' in it
+	int depth; //how many for/while/if constructs we're inside of
+	int failed; //a bool that's set once something has gone wrong, the parse functions return NULL and every caller passes it up
+	int incomplete; //a bool that's true when the line ended inside a construct, so the main loop should read another line and try again
+};
+
+//one slot of the line cache
+struct smallshCachedLine {
+	unsigned long long hash;
+	size_t length;
+	char* text; //the line as it was read, in arena
+	struct smallshNode* parsed; //what it parsed into, NULL if the slot is empty
+	struct smallshArena arena; //the copy of the line and everything parsed out of it, reset when the slot gets a different line
+};
+
+//parsed lines that keep coming up, so a script that repeats itself or someone hitting up-enter at the prompt skips lexing and parsing. 
+//it's direct mapped on a hash of the line, and a line only gets a slot the second time it's seen, so lines that never repeat don't pay 
+//for a copy
+struct smallshLineCache {
+	struct smallshCachedLine entries[LINE_CACHE_SLOTS];
+	unsigned long long seen[LINE_CACHE_SLOTS]; //the hash of the last uncached line that landed in each slot
+	long hits;
+	long misses;
+};
+
+//one command that the shell runs in its own process instead of launching a program
+struct smallshBuiltin {
+	const char* name;
+	int (*run)(struct smallshCommand* inputCommand, struct smallshContext* context); //returns the exit code to keep, or BUILTIN_KEEP_STATUS
+	int wholePipeline; //a bool, true if the builtin runs even when the line is a pipeline (it gets the whole thing, redirects and all)
+	int hasProgram; //a bool, true if there's a real program of the same name that can be run instead when the builtin can't be used
+	int readsInput; //a bool, true if the builtin can be the last stage of a pipeline and read what the stages in front of it print
+};
+
+//where command lines come from. all three ways of running the shell (typing at it or piping into stdin, a script file, or 'smallsh -c') 
+//end up as a block of bytes that lines get split out of with memchr(), so no matter where the lines come from there's no syscall per line. 
+//stdin is read INPUT_BLOCK_SIZE bytes at a time into a buffer we own, a script file is mmap()'d, and a -c string is just copied in
+struct smallshInput {
+	char* data; //the bytes lines are split out of
+	size_t length; //how many bytes of data are valid
+	size_t offset; //where the next line starts in data
+	size_t capacity; //size of the read buffer, it doubles if a single line won't fit. 0 if data is an mmap()'d file
+	int fd; //where more bytes come from when data runs out, -1 if data is all there is
+	int mapped; //a bool that's true when data is a read-only mapping, so lines have to be copied out before the lexer writes into them
+	int showPrompt; //a bool that's true when we're reading stdin, the -c and script modes don't print ': ' or flush for a terminal
+};
+
+//one run of the 'parallel' builtin's command template, kept around after it finishes so the timings can be reported at the end
+struct smallshParallelTask {
+	char* argLine; //the input line that was substituted into the template
+	pid_t pid; //-1 if the task couldn't be launched
+	int pidfd;
+	int status;
+	long long startNanos; //monotonic timestamps from when the task was launched and reaped
+	long long endNanos;
+};
+
+//one remembered command, the name the user typed and the absolute path it was found at in $PATH
+struct smallshHashEntry {
+	char* name;
+	char* path;
+	int hits; //how many times the entry has been used, shown by the 'hash' builtin like bash does
+	struct smallshHashEntry* next; //the next entry in the same bucket
+};
+
+//this is the 'hash' table from bash, it remembers where every command was found in $PATH so we can exec() the full path directly 
+//instead of having execvp() try every $PATH directory (each one a failing execve() call) for every single command. an inotify watch 
+//on each $PATH directory tells us when something is added/removed/renamed/chmod'd so we can forget any entry that might be stale
+struct smallshPathCache {
+	struct smallshHashEntry** buckets;
+	int bucketCount; //always a power of 2
+	int entryCount;
+	char* pathValue; //a copy of $PATH from when the watches were set up, if $PATH changes everything gets thrown out
+	int inotifyFD; //-1 if inotify isn't available, in that case we only notice changes when a cached path fails to exec
+	int epollFD; //the job table's epoll set, which the inotify fd gets added to
+};
+
+//one thing that happened, for the trace
+struct smallshTraceEvent {
+	const char* name; //a string literal
+	long long start; //monotonic nanoseconds
+	long long duration; //nanoseconds, -1 for an instant event
+	int track;
+	pid_t pid; //the process it's about, -1 if it isn't about one
+	int status; //the process's wait() status, -1 if there isn't one
+};
+
+//a timeline in the trace, one for the shell and one for every pipeline it launches
+struct smallshTraceTrack {
+	char name[TRACE_TRACK_NAME];
+};
+
+//the session trace. every array is allocated by traceStart() and only ever filled in by index afterwards
+struct smallshTrace {
+	struct smallshTraceEvent* events; //TRACE_MAX_EVENTS of them, NULL when tracing is off
+	int eventCount;
+	long dropped; //how many events didn't fit
+	struct smallshTraceTrack* tracks; //TRACE_MAX_TRACKS of them
+	int trackCount;
+	int lastTrack; //the track of the last pipeline launched
+	char* path; //where the JSON gets written
+	pid_t owner; //the shell's PID, so a forked child that exit()s doesn't write the trace too
+	long long origin; //when tracing started, timestamps are written relative to it
+};
+
+//one name in a directory listing
+struct smallshDirEntry {
+	unsigned int offset; //where the name starts in the listing's names
+	unsigned char length; //strlen(name), a file name can't be longer than 255 bytes
+	unsigned char type; //the d_type getdents64() gave, DT_UNKNOWN if the file system doesn't fill it in
+};
+
+//everything in one directory as of its mtime. '.' and '..' are left out. a listing that gets globbed more than once is sorted by name
+//so the matches come out sorted without sorting them, but sorting a big directory costs more than reading it, so like the line cache
+//that only happens the second time
+
+struct smallshDirListing {
+	dev_t device; //the directory's device and inode, which is what a listing is found by. a path could mean a different directory after a 'cd'
+	ino_t inode;
+	struct timespec modified; //the directory's mtime when it was read, a listing is only good while it's still the same
+	int racy; //a bool that's true if the directory was read within GLOB_RACY_NANOS of its mtime, so it could have changed without the mtime changing
+	struct smallshDirEntry* entries;
+	int count;
+	char* names; //every name, null terminated, one after another
+	int sorted; //a bool that's true once the entries have been sorted, until then each glob sorts its own matches
+	int uses; //how many globs have matched against this listing
+	long lastUsed; //globCache.clock when this was last looked at
+	int pinned; //how many globs are walking this listing right now, it can't be read again or replaced until they're done
+};
+
+//the directories that globs have listed, so a glob over a big directory that hasn't changed only costs a stat() of it
+struct smallshGlobCache {
+	struct smallshDirListing slots[GLOB_CACHE_SLOTS]; //a slot with a NULL entries is empty
+	long clock; //counts up once per lookup, for lastUsed
+	char* buffer; //GLOB_DIRENT_BUFFER bytes for getdents64() to fill, allocated the first time a directory is read
+};
+
+//job control, which the shell only does when it's interactive. each pipeline then gets a process group of its own, the foreground one 
+//gets the terminal so ^C and ^Z go to it instead of the shell, and a process stopping is noticed like one exiting is. a pidfd only says 
+//when a process exits, so SIGCHLD is blocked and read from a signalfd in the job table's epoll set to find out about stops
+struct smallshJobControl {
+	int enabled; //a bool that's true once jobControlInit() has taken over the terminal
+	int terminalFD; //the shell's own copy of the terminal, moved up out of the way of redirects. -1 for process groups without the terminal being handed around (the benchmarks do that)
+	pid_t shellGroup; //the shell's process group, which gets the terminal back after every foreground pipeline
+	pid_t originalGroup; //the process group the shell started in, which gets the terminal back when the shell exits
+	struct termios shellModes; //the terminal settings the shell started with, put back after a job that could have changed them stops or gets killed
+	int signalFD; //the SIGCHLD signalfd, -1 if there isn't one
+	int stopsPending; //a bool that's true when a foreground wait read the signalfd, so a background job could have stopped without being looked at
+	struct smallshJobTable* jobTable; //where a foreground pipeline that gets stopped goes
+};
+
+//the shell options that 'set -o' and 'set +o' turn on and off
+struct smallshOption {
+	const char* name;
+	int* flag;
+	const char* description;
+};
+
+
+extern int foregroundOnlyMode;
+extern int reportBackgroundUsage;
+extern int keepJobOutput;
+extern int noGlob;
+extern struct smallshTimeout defaultTimeout;
+extern int jobDeadlineFD;
+extern struct smallshJobControl jobControl;
+extern struct smallshGlobCache globCache;
+extern enum launcherType launcherMode;
+extern struct smallshPathCache pathCache;
+extern char pidString[32];
+extern int pidStringLen;
+extern struct smallshOption shellOptions[];
+extern struct smallshPlacementSettings placementSettings;
+extern struct smallshBuiltin builtins[];
+extern struct smallshCapture* activeCapture;
+extern struct smallshJobOutputs jobOutputs;
+extern struct smallshTrace trace;
+
+
+//timing and resource usage
+long long monotonicNanos();
+
+//the per-line arena
+void* arenaAlloc(struct smallshArena* arena, size_t size);
+char* arenaStrndup(struct smallshArena* arena, const char* string, size_t len);
+void arenaReset(struct smallshArena* arena);
+struct smallshArenaMark arenaMark(struct smallshArena* arena);
+void arenaRelease(struct smallshArena* arena, struct smallshArenaMark mark);
+
+//the lexer and expansions in lexer.c
+int lexerSelect(const char* name);
+const char* lexerImplementation();
+void lexerInit(struct smallshLexer* lexer, char* line);
+int lexNext(struct smallshLexer* lexer, struct smallshToken* token);
+char* expandWord(const char* word, struct smallshContext* context, struct smallshArena* arena, int* fieldCount);
+void expandCommand(struct smallshCommand* input, struct smallshContext* context);
+
+//pathname expansion in glob.c
+int globHasMarks(const char* word);
+void globLiteral(char* word);
+char** globWord(const char* word, struct smallshArena* arena, int* matchCount);
+
+//time limits in timeout.c
+int parseSignal(const char* text);
+void deadlineStart(struct smallshDeadline* deadline, struct smallshTimeout* timeout);
+int deadlineExpired(struct smallshDeadline* deadline);
+void deadlineStop(struct smallshDeadline* deadline);
+void jobDeadlineStart(struct smallshJobTable* jobTable, struct smallshJob* job, struct smallshTimeout* timeout);
+void jobDeadlineWatch(struct smallshJobTable* jobTable, struct smallshJob* job);
+void jobDeadlineTake(struct smallshJob* job, struct smallshDeadline* deadline);
+void jobDeadlinesExpired();
+int smallshTimeoutBuiltin(struct smallshCommand* inputCommand, struct smallshContext* context);
+
+//job control in jobcontrol.c
+void jobControlInit(struct smallshJobTable* jobTable);
+void jobControlEnd();
+void jobControlReclaim(int restoreModes);
+void jobControlDrain();
+int jobSignal(struct smallshJob* job, int signal);
+void jobStopsCheck(struct smallshJobTable* jobTable);
+struct smallshJob* stopForegroundJob(pid_t* pids, int count, int signal, const char* commandLine, int id, struct smallshDeadline* deadline, struct smallshUsage* usage, int track, long long startNanos);
+int smallshFg(struct smallshCommand* inputCommand, struct smallshContext* context);
+int smallshBg(struct smallshCommand* inputCommand, struct smallshContext* context);
+int smallshKill(struct smallshCommand* inputCommand, struct smallshContext* context);
+
+//session tracing in trace.c
+void traceStart(const char* path);
+long long traceNow();
+void traceEvent(const char* name, long long start, int track, pid_t pid, int status);
+int traceNewTrack(struct smallshCommand* input, int background);
+int traceLastTrack();
+
+//command substitution in substitute.c
+int captureDrain(struct smallshCapture* capture);
+char* runSubstitution(const char* text, size_t length, struct smallshContext* context, size_t* outputLength);
+
+//reading and parsing command lines
+void inputFromFD(struct smallshInput* input, int fd, int showPrompt);
+void inputFromString(struct smallshInput* input, const char* commands);
+int inputFromScript(struct smallshInput* input, const char* path);
+char* smallshGetInput(struct smallshInput* input, struct smallshArena* arena);
+struct smallshNode* smallshParseInput(char* inputLine, struct smallshArena* arena, int* incomplete);
+struct smallshNode* lineCacheParse(struct smallshLineCache* cache, char* line, struct smallshArena* arena, int* incomplete);
+
+//the command path cache
+void pathCacheInit(int epollFD);
+
+//launching commands
+int launchPipeline(struct smallshCommand* input, int background, int newGroup, int outputFD, pid_t* pids, int* statuses, struct smallshPlacement* placements, struct sigaction sa);
+void describePipeline(struct smallshCommand* input, char* buffer, size_t size);
+int waitPipeline(pid_t* pids, int* statuses, int count, int* childStatus, struct smallshUsage* usage, struct smallshDeadline* deadline, int track);
+int callExecForeground(struct smallshCommand* input, int* childStatus, struct smallshUsage* usage, struct sigaction sa);
+
+//the background job table
+void jobTableInit(struct smallshJobTable* jobTable, int interactive);
+struct smallshProcess* findProcess(struct smallshJobTable* jobTable, pid_t pid);
+struct smallshJob* addJob(struct smallshJobTable* jobTable, pid_t* pids, int pidCount, const char* commandLine);
+void removeJob(struct smallshJobTable* jobTable, struct smallshJob* job);
+void unwatchProcess(struct smallshJobTable* jobTable, struct smallshProcess* process);
+pid_t waitForeground(pid_t* pids, int count, int* status, struct rusage* usage, struct smallshDeadline* deadline);
+pid_t callExecBackground(struct smallshCommand* input, struct smallshJobTable* jobTable, struct sigaction sa);
+
+//the fork-free builtins in builtins.c
+int smallshEcho(struct smallshCommand* inputCommand, struct smallshContext* context);
+int smallshPrintf(struct smallshCommand* inputCommand, struct smallshContext* context);
+int smallshTest(struct smallshCommand* inputCommand, struct smallshContext* context);
+int smallshTrue(struct smallshCommand* inputCommand, struct smallshContext* context);
+int smallshFalse(struct smallshCommand* inputCommand, struct smallshContext* context);
+
+//shell variables and the main loop
+struct smallshVariable* findVariable(struct smallshContext* context, const char* name);
+int smallshExecuteNodes(struct smallshNode* node, struct smallshContext* context);
+void checkBackgroundPids(struct smallshJobTable* jobTable);
+int smallshMainLoop(struct sigaction sa, struct smallshInput* input);
+
+#endif
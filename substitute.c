@@ -0,0 +1,179 @@
+/***************************************************************************************
+* Program: SmallShell
+* Author: Lucas Moyle
+* Description: command substitution, '$(...)'. the text inside gets parsed and run by the
+*	shell itself with its stdout pointed at a pipe, so builtins in it don't fork and nothing
+*	goes through a temp file. the pipe is read out into a buffer that grows as needed while
+*	the commands run, builtins' stdout goes into that buffer directly, and expandWord() in
+*	lexer.c puts the result into the command line
+***************************************************************************************/
+
+#include "smallsh.h"
+
+
+struct smallshCapture* activeCapture = NULL; //the innermost '$(...)' being run, global since waitForeground() has to drain it while it waits
+
+
+/*	FUNCTION: captureDrain
+reads everything that's in a capture's pipe right now into its buffer without blocking, doubling the buffer whenever it fills. returns 1
+once the pipe is at end of file (or broken), 0 if there might be more later. most substitutions print a word or a line, and making the
+pipe bigger costs more than the whole rest of running one, so it only gets F_SETPIPE_SZ once the output has shown it's big. after that
+a command can print SUBSTITUTION_PIPE_SIZE between drains instead of the default 64 KiB
+*/
+int captureDrain(struct smallshCapture* capture) {
+
+	if (!capture->pipeGrown && capture->length >= CAPTURE_GROW_PIPE_AT) {
+		fcntl(capture->readFD, F_SETPIPE_SZ, SUBSTITUTION_PIPE_SIZE);
+		capture->pipeGrown = 1;
+	}
+
+	while (1) {
+		if (capture->length == capture->capacity) {
+			capture->capacity *= 2;
+			capture->data = realloc(capture->data, capture->capacity);
+			if (capture->data == NULL) {
+				perror("realloc()");
+				exit(1);
+			}
+		}
+		ssize_t got = read(capture->readFD, capture->data + capture->length, capture->capacity - capture->length);
+		if (got > 0) {
+			capture->length += got;
+		}
+		else if (got == 0) {
+			return 1;
+		}
+		else if (errno != EINTR) {
+			return errno != EAGAIN && errno != EWOULDBLOCK;
+		}
+	}
+}
+
+
+/*	FUNCTION: captureWrite
+the write function of the stdio stream that stands in for stdout while a '$(...)' runs. the shell is the only reader of the capture's 
+pipe, so a builtin that printed more than the pipe holds into it would block forever with nobody to empty it. instead what it prints is 
+added to the buffer right here, after whatever programs have put in the pipe so far so the order stays the same. a builtin whose stdout 
+was redirected ('echo x > file' or '>&2' inside the '$(...)') doesn't have the pipe on fd 1 anymore, that just gets written to fd 1
+*/
+static ssize_t captureWrite(void* cookie, const char* buffer, size_t size) {
+
+	struct smallshCapture* capture = cookie;
+	struct stat info;
+
+	if (fstat(1, &info) == -1 || info.st_dev != capture->pipeDevice || info.st_ino != capture->pipeInode) {
+		size_t written = 0;
+		while (written < size) {
+			ssize_t got = write(1, buffer + written, size - written);
+			if (got == -1 && errno == EINTR) {
+				continue;
+			}
+			if (got <= 0) {
+				return (written > 0) ? (ssize_t)written : -1;
+			}
+			written += got;
+		}
+		return size;
+	}
+
+	captureDrain(capture);
+	while (capture->capacity - capture->length < size) {
+		capture->capacity *= 2;
+		capture->data = realloc(capture->data, capture->capacity);
+		if (capture->data == NULL) {
+			perror("realloc()");
+			exit(1);
+		}
+	}
+	memcpy(capture->data + capture->length, buffer, size);
+	capture->length += size;
+	return size;
+}
+
+
+/*	FUNCTION: runSubstitution
+runs the command text of a '$(...)' and returns what it printed to stdout, with the trailing newlines taken off like sh does. the text is
+parsed into the line's arena and run with smallshExecuteNodes() like any other line, so builtins (echo, printf, test and the rest) run
+right here in the shell and a '$(...)' inside it just recurses through expandWord() to here again. since it doesn't run in a subshell,
+'exit' inside one only ends the substitution but a 'cd' sticks. programs get the pipe as their stdout, and the shell's own stdout 
+stream is swapped for one that writes into the capture (see captureWrite()) until the commands are done. returns a malloc'd buffer the caller frees (not null terminated, the
+length goes in outputLength), or NULL if there was nothing to run
+*/
+char* runSubstitution(const char* text, size_t length, struct smallshContext* context, size_t* outputLength) {
+
+	*outputLength = 0;
+
+	int incomplete = 0;
+	struct smallshNode* nodes = smallshParseInput(arenaStrndup(context->arena, text, length), context->arena, &incomplete);
+	if (nodes == NULL) {
+		if (incomplete == 1) {
+			fprintf(stderr, "smallsh: syntax error, unexpected end of input in '$(...)'\n");
+		}
+		return NULL;
+	}
+
+	int pipeFDs[2];
+	if (pipe2(pipeFDs, O_CLOEXEC) == -1) {
+		perror("pipe2()");
+		return NULL;
+	}
+	fcntl(pipeFDs[0], F_SETFL, O_NONBLOCK);
+
+	struct stat info;
+	fstat(pipeFDs[1], &info);
+	struct smallshCapture capture = { pipeFDs[0], info.st_dev, info.st_ino, malloc(CAPTURE_INITIAL_SIZE), 0, CAPTURE_INITIAL_SIZE, 0, activeCapture };
+	if (capture.data == NULL) {
+		perror("malloc()");
+		exit(1);
+	}
+	cookie_io_functions_t captureFunctions = { NULL, captureWrite, NULL, NULL };
+	FILE* captureStream = fopencookie(&capture, "w", captureFunctions);
+	if (captureStream == NULL) {
+		perror("fopencookie()");
+		close(pipeFDs[0]);
+		close(pipeFDs[1]);
+		free(capture.data);
+		return NULL;
+	}
+
+	//anything the shell already buffered for the real stdout has to go out before stdout becomes the pipe
+	fflush(stdout);
+	int savedStdout = fcntl(1, F_DUPFD_CLOEXEC, REDIRECT_HIGH_FD);
+	dup2(pipeFDs[1], 1);
+	close(pipeFDs[1]);
+	FILE* outerStdout = stdout;
+	stdout = captureStream;
+	activeCapture = &capture;
+
+	int exitShell = context->exitShell;
+	smallshExecuteNodes(nodes, context);
+	context->exitShell = exitShell;
+
+	//what's still in the stream's buffer has to go in while fd 1 is the pipe, or captureWrite() would think it was redirected
+	fflush(stdout);
+	stdout = outerStdout;
+	fclose(captureStream);
+	if (savedStdout != -1) {
+		dup2(savedStdout, 1);
+		close(savedStdout);
+	}
+	else {
+		close(1);
+	}
+	activeCapture = capture.outer;
+
+	//the shell's copy of the write end is gone now, so this reads until every process that still had it open is done with it
+	struct pollfd readable = { capture.readFD, POLLIN, 0 };
+	while (!captureDrain(&capture)) {
+		if (poll(&readable, 1, -1) == -1 && errno != EINTR) {
+			break;
+		}
+	}
+	close(capture.readFD);
+
+	while (capture.length > 0 && capture.data[capture.length - 1] == '\n') {
+		capture.length--;
+	}
+	*outputLength = capture.length;
+	return capture.data;
+}
@@ -0,0 +1,56 @@
+#!/bin/sh
+# regression checks for smallsh, run with 'make check'. each check runs one 'smallsh -c' line
+# (with a time limit, since most of what's caught here used to hang) and compares what it
+# printed and the status it exited with.
+#
+# usage: tests/regress.sh [path to smallsh]
+
+SMALLSH=${1:-./smallsh}
+TIME_LIMIT=10
+failed=0
+total=0
+
+# check NAME EXPECTED_STATUS EXPECTED_OUTPUT COMMANDS
+check() {
+	total=$((total + 1))
+	output=$(timeout "$TIME_LIMIT" "$SMALLSH" -c "$4" 2>/dev/null)
+	status=$?
+	if [ "$status" != "$2" ] || [ "$output" != "$3" ]; then
+		failed=$((failed + 1))
+		echo "FAIL $1: status $status (wanted $2), output '$(printf '%s' "$output" | head -c 200)' (wanted '$3')"
+	fi
+}
+
+# command substitution: builtins printing more than a pipe holds (64 KiB) inside a '$(...)'
+check substitution_large_builtin 0 "70001" 'echo $(printf "%070000d" 0) | wc -c'
+check substitution_large_nested 0 "168894" 'echo $(echo $(seq 1 30000)) | wc -c'
+check substitution_order 0 "a b c" 'echo $(echo a; printf "b\n" | cat; echo c)'
+
+# parallel at the end of a pipeline reads its argument lines from the stages in front of it
+check parallel_piped_stdin 0 "n a
+n b
+n c" 'printf "a\nb\nc\n" | parallel -q -j 1 echo n'
+check parallel_piped_status 2 "" 'printf "x\ny\n" | cat | parallel -q false'
+check parallel_bad_slots 2 "" 'printf "a\n" | parallel -j abc echo'
+check parallel_huge_slots 0 "a" 'printf "a\n" | parallel -q -j 99999999999 echo'
+
+# a line that doesn't parse fails with status 2, whether it's bad or just never finished
+check syntax_error_status 2 "" 'echo a |'
+check syntax_error_unfinished 2 "" 'if true; then echo a'
+check syntax_error_then_ok 0 "b" 'echo a |
+echo b'
+check comment_keeps_status 1 "" 'false
+# nothing'
+
+# a ';' has to end a command, but a trailing one and blank lines are fine
+check empty_list_element 2 "" 'echo a ; ; echo b'
+check leading_separator 2 "" '; echo a'
+check trailing_separator 0 "a" 'echo a ;'
+check separators_in_constructs 0 "x
+y" 'for i in x y; do
+echo $i;
+
+done;'
+
+echo "$((total - failed))/$total checks passed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,328 @@
+/***************************************************************************************
+* Program: SmallShell
+* Author: Lucas Moyle
+* Description: time limits on commands. 'timeout 5 cmd' runs cmd with a limit and
+*	'timeout -d 5' gives every command and job one. each limit is a timerfd: a foreground
+*	command's goes in the same poll() as its pidfd in waitForeground(), and background
+*	jobs' go in an epoll set of their own that sits in the job table's epoll set like the
+*	job output one does. when one goes off the command gets its signal, and SIGKILL when
+*	the timer goes off again after the grace period, so there's no sleeper process and
+*	nothing wakes up to check the time
+***************************************************************************************/
+
+#include "smallsh.h"
+#include <stdint.h>
+
+
+struct smallshTimeout defaultTimeout = { 0, TIMEOUT_SIGNAL, TIMEOUT_GRACE_NANOS }; //set by 'timeout -d', no limit until then
+int jobDeadlineFD = -1; //the epoll set of background jobs' timerfds, global like jobOutputs. -1 until a job has a limit
+
+
+/*	FUNCTION: parseDuration
+turns a duration like '10', '2.5', '500ms', '30s', '5m', '2h' or '1d' into nanoseconds, plain numbers are seconds like they are for
+coreutils' timeout. returns -1 if it isn't one
+*/
+static long long parseDuration(const char* text) {
+
+	char* end;
+	errno = 0;
+	double value = strtod(text, &end);
+	if (end == text || errno != 0 || !(value >= 0)) {
+		return -1;
+	}
+	double scale;
+	if (*end == '\0' || strcmp(end, "s") == 0) {
+		scale = 1e9;
+	}
+	else if (strcmp(end, "ms") == 0) {
+		scale = 1e6;
+	}
+	else if (strcmp(end, "m") == 0) {
+		scale = 60e9;
+	}
+	else if (strcmp(end, "h") == 0) {
+		scale = 3600e9;
+	}
+	else if (strcmp(end, "d") == 0) {
+		scale = 86400e9;
+	}
+	else {
+		return -1;
+	}
+	//timerfd_settime() takes a timespec, but a limit longer than a few hundred years isn't one anyway
+	if (value * scale > 1e18) {
+		return -1;
+	}
+	return (long long)(value * scale);
+}
+
+
+//turns a signal name ('TERM', 'SIGTERM', any case) or number into the signal number, -1 if it isn't one
+int parseSignal(const char* text) {
+
+	char* end;
+	long number = strtol(text, &end, 10);
+	if (end != text && *end == '\0') {
+		return (number > 0 && number < NSIG) ? (int)number : -1;
+	}
+	if (strncasecmp(text, "SIG", 3) == 0) {
+		text += 3;
+	}
+	for (int signal = 1; signal < NSIG; signal++) {
+		const char* name = sigabbrev_np(signal);
+		if (name != NULL && strcasecmp(name, text) == 0) {
+			return signal;
+		}
+	}
+	return -1;
+}
+
+
+//arms a timerfd to go off nanos from now, once
+static void deadlineArm(int timerFD, long long nanos) {
+	struct itimerspec when = { { 0, 0 }, { nanos / 1000000000LL, nanos % 1000000000LL } };
+	//a zero it_value would disarm the timer instead
+	if (when.it_value.tv_sec == 0 && when.it_value.tv_nsec == 0) {
+		when.it_value.tv_nsec = 1;
+	}
+	timerfd_settime(timerFD, 0, &when, NULL);
+}
+
+
+//starts a deadline running with a timeout's settings, or sets it up with no timer if the timeout has no limit
+void deadlineStart(struct smallshDeadline* deadline, struct smallshTimeout* timeout) {
+
+	deadline->timerFD = -1;
+	deadline->signal = timeout->signal;
+	deadline->graceNanos = timeout->graceNanos;
+	deadline->expired = 0;
+	if (timeout->nanos == 0) {
+		return;
+	}
+	deadline->timerFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (deadline->timerFD == -1) {
+		perror("timerfd_create()");
+		return;
+	}
+	deadlineArm(deadline->timerFD, timeout->nanos);
+}
+
+
+/*	FUNCTION: deadlineExpired
+called when a deadline's timerfd is readable. the first time that's the time running out, which returns the deadline's signal and
+starts the grace period, and the second time it's the grace period running out, which returns SIGKILL. returns 0 if the timer hadn't
+really gone off
+*/
+int deadlineExpired(struct smallshDeadline* deadline) {
+
+	uint64_t expirations;
+	if (read(deadline->timerFD, &expirations, sizeof(expirations)) != sizeof(expirations) || deadline->expired == 2) {
+		return 0;
+	}
+	deadline->expired++;
+	if (deadline->expired == 1 && deadline->signal != SIGKILL) {
+		if (deadline->graceNanos > 0) {
+			deadlineArm(deadline->timerFD, deadline->graceNanos);
+		}
+		return deadline->signal;
+	}
+	deadline->expired = 2;
+	return SIGKILL;
+}
+
+
+//closes a deadline's timerfd. it's taken out of the job deadline set by hand, since a child that forked but hasn't exec()'d yet would keep it in there
+void deadlineStop(struct smallshDeadline* deadline) {
+	if (deadline->timerFD == -1) {
+		return;
+	}
+	if (jobDeadlineFD != -1) {
+		epoll_ctl(jobDeadlineFD, EPOLL_CTL_DEL, deadline->timerFD, NULL);
+	}
+	close(deadline->timerFD);
+	deadline->timerFD = -1;
+}
+
+
+//gives a background job that was just added to the job table its time limit
+void jobDeadlineStart(struct smallshJobTable* jobTable, struct smallshJob* job, struct smallshTimeout* timeout) {
+	deadlineStart(&job->deadline, timeout);
+	jobDeadlineWatch(jobTable, job);
+}
+
+
+/*	FUNCTION: jobDeadlineWatch
+puts a job's running deadline in the job deadline epoll set, which gets made (and put in the job table's epoll set) the first time a 
+job needs it. that's how a new background job's limit gets watched, and how a foreground pipeline that gets stopped keeps the time 
+it had left when it goes into the job table
+*/
+void jobDeadlineWatch(struct smallshJobTable* jobTable, struct smallshJob* job) {
+
+	if (job->deadline.timerFD == -1) {
+		return;
+	}
+
+	if (jobDeadlineFD == -1) {
+		jobDeadlineFD = epoll_create1(EPOLL_CLOEXEC);
+		struct epoll_event event = {0};
+		event.events = EPOLLIN;
+		event.data.ptr = &jobDeadlineFD;
+		if (jobDeadlineFD == -1 || epoll_ctl(jobTable->epollFD, EPOLL_CTL_ADD, jobDeadlineFD, &event) == -1) {
+			perror("epoll");
+			if (jobDeadlineFD != -1) {
+				close(jobDeadlineFD);
+				jobDeadlineFD = -1;
+			}
+			deadlineStop(&job->deadline);
+			return;
+		}
+	}
+
+	struct epoll_event event = {0};
+	event.events = EPOLLIN;
+	event.data.ptr = job;
+	if (epoll_ctl(jobDeadlineFD, EPOLL_CTL_ADD, job->deadline.timerFD, &event) == -1) {
+		perror("epoll_ctl()");
+		deadlineStop(&job->deadline);
+	}
+}
+
+
+//moves a job's deadline out of the job deadline set and into deadline, still running, for 'fg' to sleep on while it waits for the job
+void jobDeadlineTake(struct smallshJob* job, struct smallshDeadline* deadline) {
+	*deadline = job->deadline;
+	if (deadline->timerFD != -1 && jobDeadlineFD != -1) {
+		epoll_ctl(jobDeadlineFD, EPOLL_CTL_DEL, deadline->timerFD, NULL);
+	}
+	job->deadline.timerFD = -1;
+}
+
+
+/*	FUNCTION: jobDeadlinesExpired
+sends the signal (or SIGKILL) to each background job whose timer went off, one epoll_wait() on the job deadline set says which. a job
+with a process group of its own gets it through killpg() like coreutils' timeout does, so whatever its processes started goes too, see
+jobSignal(). a stopped process couldn't act on its signal, so it gets a SIGCONT too
+*/
+void jobDeadlinesExpired() {
+
+	struct epoll_event events[MAX_EPOLL_EVENTS];
+	int eventCount;
+
+	do {
+		eventCount = epoll_wait(jobDeadlineFD, events, MAX_EPOLL_EVENTS, 0);
+		for (int i = 0; i < eventCount; i++) {
+			struct smallshJob* job = events[i].data.ptr;
+			int signal = deadlineExpired(&job->deadline);
+			if (signal != 0) {
+				jobSignal(job, signal);
+				jobSignal(job, SIGCONT);
+			}
+		}
+	} while (eventCount == MAX_EPOLL_EVENTS);
+}
+
+
+//formats a duration in seconds for 'timeout' to show
+static void printDuration(const char* label, long long nanos) {
+	printf("%s%gs", label, nanos / 1e9);
+}
+
+
+/*	FUNCTION: smallshTimeoutBuiltin
+built-in timeout command. 'timeout DURATION [-s SIGNAL] [-k GRACE] command args...' runs the rest of the line (the whole pipeline, and
+in the background if it ends in '&') and sends it SIGNAL (TERM by default) once DURATION is up, then KILL if it's still going GRACE
+(5s by default, 0 for never) after that. the options can go before or after the duration. 'timeout -d DURATION [-s SIGNAL] [-k GRACE]'
+makes that the limit for every command and job from then on that doesn't have its own, 'timeout -d off' takes it away and 'timeout'
+by itself shows it. like 'time', it shifts itself off the front of the arguments for as long as the command runs
+*/
+int smallshTimeoutBuiltin(struct smallshCommand* inputCommand, struct smallshContext* context) {
+
+	if (inputCommand->argCount == 1) {
+		if (defaultTimeout.nanos == 0) {
+			printf("timeout: no default limit\n");
+		}
+		else {
+			printDuration("timeout: every command gets ", defaultTimeout.nanos);
+			printf(", then SIG%s", sigabbrev_np(defaultTimeout.signal));
+			if (defaultTimeout.graceNanos > 0 && defaultTimeout.signal != SIGKILL) {
+				printDuration(" and SIGKILL ", defaultTimeout.graceNanos);
+				printf(" later");
+			}
+			printf("\n");
+		}
+		return BUILTIN_KEEP_STATUS;
+	}
+
+	struct smallshTimeout limit = { -1, TIMEOUT_SIGNAL, TIMEOUT_GRACE_NANOS };
+	int setDefault = 0;
+	int turnOff = 0;
+	int i = 1;
+	for (; i < inputCommand->argCount; i++) {
+		char* argument = inputCommand->arguments[i];
+		if (strcmp(argument, "-d") == 0) {
+			setDefault = 1;
+		}
+		else if ((strcmp(argument, "-s") == 0 || strcmp(argument, "-k") == 0) && i + 1 < inputCommand->argCount) {
+			char* value = inputCommand->arguments[++i];
+			if (argument[1] == 's' && (limit.signal = parseSignal(value)) == -1) {
+				fprintf(stderr, "timeout: %s: invalid signal\n", value);
+				return 125;
+			}
+			if (argument[1] == 'k' && (limit.graceNanos = parseDuration(value)) == -1) {
+				fprintf(stderr, "timeout: %s: invalid duration\n", value);
+				return 125;
+			}
+		}
+		else if (limit.nanos == -1 && !turnOff) {
+			if (setDefault && strcmp(argument, "off") == 0) {
+				turnOff = 1;
+			}
+			else if ((limit.nanos = parseDuration(argument)) == -1) {
+				fprintf(stderr, "timeout: %s: invalid duration\n", argument);
+				return 125;
+			}
+		}
+		else {
+			break;
+		}
+	}
+
+	if (setDefault) {
+		if (i < inputCommand->argCount || (limit.nanos == -1 && !turnOff)) {
+			fprintf(stderr, "usage: timeout -d DURATION|off [-s SIGNAL] [-k GRACE]\n");
+			return 125;
+		}
+		defaultTimeout = limit;
+		if (turnOff) {
+			defaultTimeout.nanos = 0;
+		}
+		return BUILTIN_KEEP_STATUS;
+	}
+	if (limit.nanos == -1 || i == inputCommand->argCount) {
+		fprintf(stderr, "usage: timeout DURATION [-s SIGNAL] [-k GRACE] command [args...]\n");
+		return 125;
+	}
+
+	inputCommand->arguments += i;
+	inputCommand->argCount -= i;
+	inputCommand->argCapacity -= i;
+	inputCommand->command = inputCommand->arguments[0];
+	inputCommand->timeout = &limit;
+
+	if (inputCommand->ampersand && !foregroundOnlyMode) {
+		pid_t lastPid = callExecBackground(inputCommand, context->jobTable, context->sa);
+		if (lastPid != -1) {
+			context->lastBackgroundPid = lastPid;
+		}
+	}
+	else {
+		context->timedOut = callExecForeground(inputCommand, &context->childStatus, &context->lastUsage, context->sa);
+	}
+
+	inputCommand->timeout = NULL;
+	inputCommand->arguments -= i;
+	inputCommand->argCount += i;
+	inputCommand->argCapacity += i;
+	inputCommand->command = inputCommand->arguments[0];
+	return BUILTIN_KEEP_STATUS;
+}
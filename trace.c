@@ -0,0 +1,171 @@
+/***************************************************************************************
+* Program: SmallShell
+* Author: Lucas Moyle
+* Description: session tracing. with SMALLSH_TRACE=file set, the shell records when it read
+*	each line, parsed it, launched each process, saw it exec() and reaped it, and writes it
+*	all out at exit as Chrome trace-event JSON (load it in chrome://tracing or Perfetto).
+*	each pipeline the shell launches gets its own track, named after its command line.
+*	the events go into an array that's allocated once at startup and filled in by index,
+*	the timestamps come from the vDSO clock, and nothing gets written until exit, so
+*	tracing doesn't add a single syscall to reading, parsing or launching
+***************************************************************************************/
+
+#include "smallsh.h"
+
+
+static void traceFlush(); //atexit() gets it in traceStart()
+
+struct smallshTrace trace = { NULL }; //global since the main loop, the launcher and the reaper all add to it, events is NULL when tracing is off
+
+
+/*	FUNCTION: traceStart
+turns tracing on, writing to path when the shell exits. everything the trace will ever need is allocated here, once the buffer fills up
+later events are just counted. track 0 is the shell itself
+*/
+void traceStart(const char* path) {
+
+	trace.events = malloc(sizeof(struct smallshTraceEvent) * TRACE_MAX_EVENTS);
+	trace.tracks = malloc(sizeof(struct smallshTraceTrack) * TRACE_MAX_TRACKS);
+	trace.path = strdup(path);
+	if (trace.events == NULL || trace.tracks == NULL || trace.path == NULL) {
+		perror("malloc()");
+		exit(1);
+	}
+	//touch every page now so the first events don't each take a page fault
+	memset(trace.events, 0, sizeof(struct smallshTraceEvent) * TRACE_MAX_EVENTS);
+	memset(trace.tracks, 0, sizeof(struct smallshTraceTrack) * TRACE_MAX_TRACKS);
+	trace.eventCount = 0;
+	trace.dropped = 0;
+	trace.owner = getpid();
+	trace.origin = monotonicNanos();
+	strcpy(trace.tracks[0].name, "smallsh");
+	trace.trackCount = 1;
+	trace.lastTrack = 0;
+	atexit(traceFlush);
+}
+
+
+//the time to start an event at, 0 when tracing is off so the clock doesn't even get read
+long long traceNow() {
+	return (trace.events != NULL) ? monotonicNanos() : 0;
+}
+
+
+/*	FUNCTION: traceEvent
+adds one event to the buffer, an instant one if start is -1 and one that runs from start to now otherwise. name has to be a string that
+lives forever, like a literal. pid is the process it's about and status its wait() status, either can be -1 if it doesn't apply
+*/
+void traceEvent(const char* name, long long start, int track, pid_t pid, int status) {
+
+	if (trace.events == NULL) {
+		return;
+	}
+	if (trace.eventCount == TRACE_MAX_EVENTS) {
+		trace.dropped++;
+		return;
+	}
+	struct smallshTraceEvent* event = &trace.events[trace.eventCount++];
+	long long now = monotonicNanos();
+	event->name = name;
+	event->start = (start == -1) ? now : start;
+	event->duration = (start == -1) ? -1 : now - start;
+	event->track = track;
+	event->pid = pid;
+	event->status = status;
+}
+
+
+/*	FUNCTION: traceNewTrack
+starts a track for a pipeline that's about to be launched and makes it the one traceLastTrack() returns. it's named after the pipeline's
+command line (see describePipeline()). once every track is used up the rest share the shell's track 0
+*/
+int traceNewTrack(struct smallshCommand* input, int background) {
+
+	if (trace.events == NULL) {
+		return 0;
+	}
+	if (trace.trackCount == TRACE_MAX_TRACKS) {
+		trace.lastTrack = 0;
+		return 0;
+	}
+
+	struct smallshTraceTrack* track = &trace.tracks[trace.trackCount];
+	size_t length = snprintf(track->name, TRACE_TRACK_NAME, "%s ", background ? "bg" : "fg");
+	describePipeline(input, track->name + length, TRACE_TRACK_NAME - length);
+	trace.lastTrack = trace.trackCount++;
+	return trace.lastTrack;
+}
+
+
+//the track of the pipeline launchPipeline() started last
+int traceLastTrack() {
+	return trace.lastTrack;
+}
+
+
+//writes a string as a JSON string literal
+static void traceWriteString(FILE* out, const char* string) {
+	fputc('"', out);
+	for (const unsigned char* c = (const unsigned char*)string; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(out, "\\%c", *c);
+		}
+		else if (*c < 0x20) {
+			fprintf(out, "\\u%04x", *c);
+		}
+		else {
+			fputc(*c, out);
+		}
+	}
+	fputc('"', out);
+}
+
+
+/*	FUNCTION: traceFlush
+writes the trace out as Chrome trace-event JSON, this is registered with atexit() so it happens however the shell exits. timestamps are
+microseconds since tracing started. every track is a thread of the shell's process in the viewer, with a metadata event naming it. a
+child that exit()s before it gets to exec() runs atexit() handlers too, so only the shell itself writes anything
+*/
+static void traceFlush() {
+
+	if (trace.events == NULL || getpid() != trace.owner) {
+		return;
+	}
+
+	FILE* out = fopen(trace.path, "w");
+	if (out == NULL) {
+		fprintf(stderr, "smallsh: trace: %s: %s\n", trace.path, strerror(errno));
+		return;
+	}
+
+	fprintf(out, "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped\": %ld}, \"traceEvents\": [\n", trace.dropped);
+	for (int i = 0; i < trace.trackCount; i++) {
+		fprintf(out, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": ", trace.owner, i);
+		traceWriteString(out, trace.tracks[i].name);
+		fprintf(out, "}},\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"sort_index\": %d}}%s\n",
+			trace.owner, i, i, (i + 1 < trace.trackCount || trace.eventCount > 0) ? "," : "");
+	}
+	for (int i = 0; i < trace.eventCount; i++) {
+		struct smallshTraceEvent* event = &trace.events[i];
+		if (event->duration == -1) {
+			fprintf(out, "{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, ", event->name, (event->start - trace.origin) / 1000.0);
+		}
+		else {
+			fprintf(out, "{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, ", event->name, (event->start - trace.origin) / 1000.0, event->duration / 1000.0);
+		}
+		fprintf(out, "\"pid\": %d, \"tid\": %d, \"args\": {", trace.owner, event->track);
+		if (event->pid != -1) {
+			fprintf(out, "\"pid\": %d", event->pid);
+		}
+		if (event->status != -1) {
+			fprintf(out, "%s\"status\": %d", (event->pid != -1) ? ", " : "", WIFEXITED(event->status) ? WEXITSTATUS(event->status) : 128 + WTERMSIG(event->status));
+		}
+		fprintf(out, "}}%s\n", (i + 1 < trace.eventCount) ? "," : "");
+	}
+	fprintf(out, "]}\n");
+	fclose(out);
+
+	if (trace.dropped > 0) {
+		fprintf(stderr, "smallsh: trace: the buffer filled up, %ld events weren't recorded\n", trace.dropped);
+	}
+}